@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * KUnit tests of the init sequence, run against a fake DSI host that
+ * records every transfer with its time on a virtual clock. Included by
+ * panel-dxwy-d350t1013v1.c when built with D350T1013V1_KUNIT_TEST.
+ */
+
+#include <kunit/static_stub.h>
+#include <kunit/test.h>
+
+#if !IS_ENABLED(CONFIG_KUNIT)
+#error "D350T1013V1_KUNIT_TEST needs a kernel with CONFIG_KUNIT"
+#endif
+
+#define D350T1013V1_TEST_MAX_XFERS	64
+#define D350T1013V1_TEST_MAX_LEN	32
+
+struct d350t1013v1_test_xfer {
+	u8 data[D350T1013V1_TEST_MAX_LEN];
+	size_t len;
+	ktime_t at;
+};
+
+struct d350t1013v1_test {
+	struct mipi_dsi_host host;
+	struct mipi_dsi_device dsi;
+	struct d350t1013v1 ctx;
+	struct d350t1013v1_test_xfer xfers[D350T1013V1_TEST_MAX_XFERS];
+	unsigned int num_xfers;
+	/* Virtual clock, only advanced by the waits of the driver. */
+	ktime_t now;
+};
+
+static ktime_t d350t1013v1_test_clock(struct d350t1013v1 *ctx)
+{
+	struct d350t1013v1_test *t = container_of(ctx, struct d350t1013v1_test, ctx);
+
+	return t->now;
+}
+
+static void d350t1013v1_test_sleep_us(struct d350t1013v1 *ctx, s64 us)
+{
+	struct d350t1013v1_test *t = container_of(ctx, struct d350t1013v1_test, ctx);
+
+	t->now = ktime_add_us(t->now, us);
+}
+
+static ssize_t d350t1013v1_test_transfer(struct mipi_dsi_host *host,
+					 const struct mipi_dsi_msg *msg)
+{
+	struct d350t1013v1_test *t =
+		container_of(host, struct d350t1013v1_test, host);
+	struct d350t1013v1_test_xfer *xfer;
+
+	if (t->num_xfers == ARRAY_SIZE(t->xfers) ||
+	    msg->tx_len > sizeof(xfer->data))
+		return -ENOSPC;
+
+	xfer = &t->xfers[t->num_xfers++];
+	xfer->at = t->now;
+	memcpy(xfer->data, msg->tx_buf, msg->tx_len);
+	xfer->len = msg->tx_len;
+
+	return msg->tx_len;
+}
+
+static const struct mipi_dsi_host_ops d350t1013v1_test_host_ops = {
+	.transfer = d350t1013v1_test_transfer,
+};
+
+struct d350t1013v1_test_cmd {
+	const u8 *data;
+	u8 len;
+	/* Minimum time until the next transfer, or NULL. */
+	const unsigned int *min_delay_ms;
+};
+
+#define D350T1013V1_TEST_CMD_DELAY(_delay, seq...) \
+	{ \
+		.data = (const u8[]){ seq }, \
+		.len = sizeof((const u8[]){ seq }), \
+		.min_delay_ms = _delay, \
+	}
+
+#define D350T1013V1_TEST_CMD(seq...) \
+	D350T1013V1_TEST_CMD_DELAY(NULL, seq)
+
+/*
+ * The init sequence as originally sent by the driver, one msleep() after
+ * the power settings, each of the analog settings, sleep-out and COLMOD.
+ * Those sleeps now have to last at least the panel timings.
+ */
+static const struct d350t1013v1_test_cmd d350t1013v1_test_baseline[] = {
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x13),
+	D350T1013V1_TEST_CMD(0xEF, 0x08),
+
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x10),
+	D350T1013V1_TEST_CMD(0xC0, 0x63, 0x00),
+	D350T1013V1_TEST_CMD(0xC1, 0x10, 0x02),
+	D350T1013V1_TEST_CMD(0xC2, 0x31, 0x02),
+	D350T1013V1_TEST_CMD(0xCC, 0x10),
+	D350T1013V1_TEST_CMD(0xB0, 0xC0, 0x0C, 0x92, 0x0C, 0x10, 0x05, 0x02,
+		0x0D, 0x07, 0x21, 0x04, 0x53, 0x11, 0x6A, 0x32, 0x1F),
+	D350T1013V1_TEST_CMD(0xB1, 0xC0, 0x87, 0xCF, 0x0C, 0x10, 0x06, 0x00,
+		0x03, 0x08, 0x1D, 0x06, 0x54, 0x12, 0xE6, 0xEC, 0x0F),
+
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x11),
+	D350T1013V1_TEST_CMD(0xB0, 0x5D),
+	D350T1013V1_TEST_CMD(0xB1, 0x62),
+	D350T1013V1_TEST_CMD(0xB2, 0x82),
+	D350T1013V1_TEST_CMD(0xB3, 0x80),
+	D350T1013V1_TEST_CMD(0xB5, 0x42),
+	D350T1013V1_TEST_CMD(0xB7, 0x85),
+	D350T1013V1_TEST_CMD(0xB8, 0x20),
+	D350T1013V1_TEST_CMD(0xC0, 0x09),
+	D350T1013V1_TEST_CMD(0xC1, 0x78),
+	D350T1013V1_TEST_CMD(0xC2, 0x78),
+	D350T1013V1_TEST_CMD(0xD0, 0x88),
+	D350T1013V1_TEST_CMD_DELAY(&d350t1013v1_timings.power_setup_ms,
+		0xEE, 0x42),
+
+	D350T1013V1_TEST_CMD(0xE0, 0x00, 0x00, 0x02),
+	D350T1013V1_TEST_CMD(0xE1, 0x04, 0xA0, 0x06, 0xA0, 0x05, 0xA0, 0x07,
+		0xA0, 0x00, 0x44, 0x44),
+	D350T1013V1_TEST_CMD(0xE2, 0x00, 0x00, 0x33, 0x33, 0x01, 0xA0, 0x00,
+		0x00, 0x01, 0xA0, 0x00, 0x00),
+	D350T1013V1_TEST_CMD(0xE3, 0x00, 0x00, 0x33, 0x33),
+	D350T1013V1_TEST_CMD(0xE4, 0x44, 0x44),
+	D350T1013V1_TEST_CMD(0xE5, 0x0C, 0x30, 0xA0, 0xA0, 0x0E, 0x32, 0xA0,
+		0xA0, 0x08, 0x2C, 0xA0, 0xA0, 0x0A, 0x2E, 0xA0, 0xA0),
+	D350T1013V1_TEST_CMD(0xE6, 0x00, 0x00, 0x33, 0x33),
+	D350T1013V1_TEST_CMD(0xE7, 0x44, 0x44),
+	D350T1013V1_TEST_CMD(0xE8, 0x0D, 0x31, 0xA0, 0xA0, 0x0F, 0x33, 0xA0,
+		0xA0, 0x09, 0x2D, 0xA0, 0xA0, 0x0B, 0x2F, 0xA0, 0xA0),
+	D350T1013V1_TEST_CMD(0xEB, 0x00, 0x01, 0xE4, 0xE4, 0x44, 0x88, 0x00),
+	D350T1013V1_TEST_CMD(0xED, 0xFF, 0xF5, 0x47, 0x6F, 0x0B, 0xA1, 0xA2,
+		0xBF, 0xFB, 0x2A, 0x1A, 0xB0, 0xF6, 0x74, 0x5F, 0xFF),
+	D350T1013V1_TEST_CMD(0xEF, 0x08, 0x08, 0x08, 0x40, 0x3F, 0x64),
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x13),
+	D350T1013V1_TEST_CMD_DELAY(&d350t1013v1_timings.analog_setup_ms,
+		0xE8, 0x00, 0x0E),
+
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x00),
+	D350T1013V1_TEST_CMD_DELAY(&d350t1013v1_timings.sleep_out_ms, 0x11),
+
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x13),
+	D350T1013V1_TEST_CMD_DELAY(&d350t1013v1_timings.analog_setup_ms,
+		0xE8, 0x00, 0x0C),
+
+	D350T1013V1_TEST_CMD(0xE8, 0x00, 0x00),
+	D350T1013V1_TEST_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x00),
+
+	D350T1013V1_TEST_CMD_DELAY(&d350t1013v1_timings.colmod_ms, 0x3A, 0x50),
+};
+
+static int d350t1013v1_test_init(struct kunit *test)
+{
+	struct d350t1013v1_test *t;
+	struct d350t1013v1 *ctx;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	t->host.ops = &d350t1013v1_test_host_ops;
+	t->dsi.host = &t->host;
+	t->dsi.dev.init_name = "d350t1013v1-test";
+	t->dsi.mode_flags = d350t1013v1_desc.flags;
+	t->dsi.lanes = d350t1013v1_desc.lanes;
+
+	ctx = &t->ctx;
+	ctx->dsi = &t->dsi;
+	ctx->desc = &d350t1013v1_desc;
+	ctx->timings = *d350t1013v1_desc.timings;
+	ctx->init_cmds = d350t1013v1_desc.init_cmds;
+	ctx->num_init_cmds = d350t1013v1_desc.num_init_cmds;
+	ctx->cmd_failures = kunit_kcalloc(test, ctx->num_init_cmds,
+					  sizeof(*ctx->cmd_failures), GFP_KERNEL);
+	ctx->profiles = kunit_kzalloc(test, sizeof(*ctx->profiles), GFP_KERNEL);
+	if (!ctx->cmd_failures || !ctx->profiles)
+		return -ENOMEM;
+
+	/* The init sequence itself programs the default profile. */
+	ctx->profiles[D350T1013V1_PROFILE_DEFAULT].name = "default";
+	ctx->num_profiles = 1;
+	mutex_init(&ctx->lock);
+	mutex_init(&ctx->stats_lock);
+	ctx->state_since = ktime_get();
+
+	kunit_activate_static_stub(test, d350t1013v1_clock, d350t1013v1_test_clock);
+	kunit_activate_static_stub(test, d350t1013v1_sleep_us,
+				   d350t1013v1_test_sleep_us);
+
+	test->priv = t;
+
+	return 0;
+}
+
+static void d350t1013v1_test_init_sequence(struct kunit *test)
+{
+	struct d350t1013v1_test *t = test->priv;
+	struct d350t1013v1_panel_desc desc = d350t1013v1_desc;
+	const struct d350t1013v1_test_cmd *cmd;
+	struct d350t1013v1_test_xfer *xfer;
+	ktime_t next;
+	unsigned int i;
+
+	/* The original sequence programmed COLMOD for RGB565. */
+	desc.format = MIPI_DSI_FMT_RGB565;
+	KUNIT_ASSERT_EQ(test, d350t1013v1_init_format(&t->ctx, &t->dsi, &desc), 0);
+
+	KUNIT_ASSERT_EQ(test, d350t1013v1_init_sequence(&t->ctx), 0);
+	KUNIT_ASSERT_EQ(test, t->num_xfers, ARRAY_SIZE(d350t1013v1_test_baseline));
+
+	for (i = 0; i < t->num_xfers; i++) {
+		cmd = &d350t1013v1_test_baseline[i];
+		xfer = &t->xfers[i];
+
+		KUNIT_EXPECT_EQ_MSG(test, xfer->len, cmd->len, "transfer %u", i);
+		KUNIT_EXPECT_MEMEQ_MSG(test, xfer->data, cmd->data,
+				       min_t(size_t, xfer->len, cmd->len),
+				       "transfer %u", i);
+
+		if (!cmd->min_delay_ms)
+			continue;
+
+		/* The delay of the last command is left to the next step. */
+		next = i + 1 < t->num_xfers ? t->xfers[i + 1].at : t->ctx.ready_at;
+		KUNIT_EXPECT_GE_MSG(test, ktime_us_delta(next, xfer->at),
+				    (s64)*cmd->min_delay_ms * USEC_PER_MSEC,
+				    "delay after transfer %u", i);
+	}
+}
+
+static const struct d350t1013v1_test_format {
+	enum mipi_dsi_pixel_format format;
+	u8 colmod;
+} d350t1013v1_test_formats[] = {
+	{ MIPI_DSI_FMT_RGB888, 0x70 },
+	{ MIPI_DSI_FMT_RGB666, 0x60 },
+	{ MIPI_DSI_FMT_RGB666_PACKED, 0x60 },
+	{ MIPI_DSI_FMT_RGB565, 0x50 },
+};
+
+static void d350t1013v1_test_format_desc(const struct d350t1013v1_test_format *format,
+					 char *desc)
+{
+	snprintf(desc, KUNIT_PARAM_DESC_SIZE, "%s",
+		 d350t1013v1_format_names[format->format]);
+}
+
+KUNIT_ARRAY_PARAM(d350t1013v1_test_format, d350t1013v1_test_formats,
+		  d350t1013v1_test_format_desc);
+
+static void d350t1013v1_test_colmod(struct kunit *test)
+{
+	const struct d350t1013v1_test_format *format = test->param_value;
+	struct d350t1013v1_test *t = test->priv;
+	struct d350t1013v1_panel_desc desc = d350t1013v1_desc;
+	struct d350t1013v1_test_xfer *xfer;
+
+	desc.format = format->format;
+	KUNIT_ASSERT_EQ(test, d350t1013v1_init_format(&t->ctx, &t->dsi, &desc), 0);
+
+	KUNIT_ASSERT_EQ(test, d350t1013v1_init_sequence(&t->ctx), 0);
+	KUNIT_ASSERT_EQ(test, t->num_xfers, t->ctx.num_init_cmds + 1);
+
+	xfer = &t->xfers[t->num_xfers - 1];
+	KUNIT_EXPECT_EQ(test, xfer->len, 2);
+	KUNIT_EXPECT_EQ(test, xfer->data[0], MIPI_DCS_SET_PIXEL_FORMAT);
+	KUNIT_EXPECT_EQ(test, xfer->data[1], format->colmod);
+}
+
+static void d350t1013v1_test_check_init_cmds(struct kunit *test)
+{
+	struct d350t1013v1_test *t = test->priv;
+
+	KUNIT_EXPECT_EQ(test, d350t1013v1_check_init_cmds(&t->dsi.dev,
+							  d350t1013v1_init_cmds,
+							  ARRAY_SIZE(d350t1013v1_init_cmds)),
+			0);
+}
+
+static struct kunit_case d350t1013v1_test_cases[] = {
+	KUNIT_CASE(d350t1013v1_test_init_sequence),
+	KUNIT_CASE_PARAM(d350t1013v1_test_colmod, d350t1013v1_test_format_gen_params),
+	KUNIT_CASE(d350t1013v1_test_check_init_cmds),
+	{ }
+};
+
+static struct kunit_suite d350t1013v1_test_suite = {
+	.name = "d350t1013v1",
+	.init = d350t1013v1_test_init,
+	.test_cases = d350t1013v1_test_cases,
+};
+kunit_test_suite(d350t1013v1_test_suite);
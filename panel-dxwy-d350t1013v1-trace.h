@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Copyright (C) 2022, ENQT GmbH.
+ * Author: Sebastian Urban <surban@surban.net>
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM d350t1013v1
+
+#if !defined(_PANEL_DXWY_D350T1013V1_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _PANEL_DXWY_D350T1013V1_TRACE_H
+
+#include <linux/string.h>
+#include <linux/tracepoint.h>
+
+#define D350T1013V1_TRACE_NAME_LEN	16
+
+TRACE_EVENT(d350t1013v1_phase_begin,
+	TP_PROTO(const char *phase),
+	TP_ARGS(phase),
+	TP_STRUCT__entry(
+		__array(char, phase, D350T1013V1_TRACE_NAME_LEN)
+	),
+	TP_fast_assign(
+		strscpy(__entry->phase, phase, D350T1013V1_TRACE_NAME_LEN);
+	),
+	TP_printk("phase=%s", __entry->phase)
+);
+
+TRACE_EVENT(d350t1013v1_phase_end,
+	TP_PROTO(const char *phase, s64 duration_us, int ret),
+	TP_ARGS(phase, duration_us, ret),
+	TP_STRUCT__entry(
+		__array(char, phase, D350T1013V1_TRACE_NAME_LEN)
+		__field(s64, duration_us)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		strscpy(__entry->phase, phase, D350T1013V1_TRACE_NAME_LEN);
+		__entry->duration_us = duration_us;
+		__entry->ret = ret;
+	),
+	TP_printk("phase=%s duration_us=%lld ret=%d", __entry->phase,
+		  __entry->duration_us, __entry->ret)
+);
+
+TRACE_EVENT(d350t1013v1_wait,
+	TP_PROTO(s64 requested_us, s64 actual_us),
+	TP_ARGS(requested_us, actual_us),
+	TP_STRUCT__entry(
+		__field(s64, requested_us)
+		__field(s64, actual_us)
+	),
+	TP_fast_assign(
+		__entry->requested_us = requested_us;
+		__entry->actual_us = actual_us;
+	),
+	TP_printk("requested_us=%lld actual_us=%lld", __entry->requested_us,
+		  __entry->actual_us)
+);
+
+#endif /* _PANEL_DXWY_D350T1013V1_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE panel-dxwy-d350t1013v1-trace
+#include <trace/define_trace.h>
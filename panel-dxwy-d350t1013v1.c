@@ -4,254 +4,2966 @@
  * Author: Sebastian Urban <surban@surban.net>
  */
 
+#include <drm/drm_connector.h>
+#include <drm/drm_crtc.h>
 #include <drm/drm_mipi_dsi.h>
 #include <drm/drm_modes.h>
 #include <drm/drm_panel.h>
 
+#include <kunit/static_stub.h>
+
+#include <linux/backlight.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/gpio/consumer.h>
 #include <linux/delay.h>
+#include <linux/firmware.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/media-bus-format.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of_device.h>
+#include <linux/pm_runtime.h>
 #include <linux/regulator/consumer.h>
+#include <linux/sched/signal.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+
+#include <video/mipi_display.h>
+
+#define CREATE_TRACE_POINTS
+#include "panel-dxwy-d350t1013v1-trace.h"
+
+/*
+ * Bring-up delays in milliseconds. Where the ST7701S controller datasheet
+ * specifies a timing, the default is that minimum value.
+ */
+struct d350t1013v1_timings {
+	/* Supply ramp and reset-low hold before releasing reset. */
+	unsigned int supply_ramp_ms;
+	/* Reset release until commands are accepted (tRT in sleep-in). */
+	unsigned int reset_ms;
+	/* Software reset until the next command. */
+	unsigned int soft_reset_ms;
+	/* Sleep-out until the next command may rely on it. */
+	unsigned int sleep_out_ms;
+	/* Settling of the bank 0x11 power settings. */
+	unsigned int power_setup_ms;
+	/* Settling of the bank 0x13 analog (0xE8) settings. */
+	unsigned int analog_setup_ms;
+	/* After setting the pixel format. */
+	unsigned int colmod_ms;
+	/* Sleep-in until the supply may be removed. */
+	unsigned int sleep_in_ms;
+};
+
+/* Post-delays of init commands, referring to struct d350t1013v1_timings. */
+enum d350t1013v1_delay {
+	D350T1013V1_DELAY_NONE,
+	D350T1013V1_DELAY_SLEEP_OUT,
+	D350T1013V1_DELAY_POWER_SETUP,
+	D350T1013V1_DELAY_ANALOG_SETUP,
+};
+
+#define D350T1013V1_NUM_DELAYS	(D350T1013V1_DELAY_ANALOG_SETUP + 1)
+
+struct d350t1013v1_cmd {
+	const u8 *data;
+	u8 len;
+	u8 delay;
+};
+
+#define D350T1013V1_CMD_DELAY(_delay, seq...) \
+	{ \
+		.data = (const u8[]){ seq }, \
+		.len = sizeof((const u8[]){ seq }), \
+		.delay = _delay, \
+	}
+
+#define D350T1013V1_CMD(seq...) \
+	D350T1013V1_CMD_DELAY(D350T1013V1_DELAY_NONE, seq)
+
+/* Command 2 bank select: 0xFF 0x77 0x01 0x00 0x00 <bank>. */
+#define D350T1013V1_BKSEL		0xFF
+#define D350T1013V1_BKSEL_LEN	6
+#define D350T1013V1_BANK_NONE	0x00
+
+/*
+ * Init sequence firmware: the magic followed by one record per command,
+ * consisting of the opcode, the payload length, the payload and the
+ * post-delay as enum d350t1013v1_delay.
+ */
+#define D350T1013V1_FW_MAGIC		"D350"
+#define D350T1013V1_FW_MAGIC_LEN	4
+#define D350T1013V1_FW_MAX_PAYLOAD	(U8_MAX - 1)
+
+/*
+ * Gamma and power profile: writes to the gamma registers B0h/B1h of bank
+ * 0x10 and to the power registers of bank 0x11, with their bank selects.
+ */
+struct d350t1013v1_profile {
+	const char *name;
+	const struct d350t1013v1_cmd *cmds;
+	unsigned int num_cmds;
+};
+
+/* Derived from the init sequence, further profiles are loaded from firmware. */
+#define D350T1013V1_PROFILE_DEFAULT	0
+#define D350T1013V1_PROFILE_UNKNOWN	UINT_MAX
+#define D350T1013V1_MAX_PROFILES	8
+#define D350T1013V1_BANK_GAMMA		0x10
+#define D350T1013V1_BANK_POWER		0x11
+
+/*
+ * Everything specific to a panel variant. Each variant gets its own
+ * descriptor and compatible, so that it runs with the timings and init
+ * sequence it was qualified with.
+ */
+struct d350t1013v1_panel_desc {
+	const struct drm_display_mode *modes;
+	unsigned int num_modes;
+	const struct d350t1013v1_timings *timings;
+	const struct d350t1013v1_cmd *init_cmds;
+	unsigned int num_init_cmds;
+	/* Default name of the init sequence firmware replacing init_cmds. */
+	const char *firmware_name;
+	unsigned int lanes;
+	unsigned long flags;
+	enum mipi_dsi_pixel_format format;
+	const char *const *supply_names;
+	unsigned int num_supplies;
+};
+
+/* Bring-up phases, each covering an action and its delay. */
+enum d350t1013v1_phase {
+	D350T1013V1_PHASE_REGULATOR,
+	D350T1013V1_PHASE_RESET,
+	D350T1013V1_PHASE_SOFT_RESET,
+	D350T1013V1_PHASE_SLEEP_OUT,
+	D350T1013V1_PHASE_READ_ID,
+	D350T1013V1_PHASE_INIT_CMD1,
+	D350T1013V1_PHASE_INIT_BK0,
+	D350T1013V1_PHASE_INIT_BK1,
+	D350T1013V1_PHASE_INIT_BK2,
+	D350T1013V1_PHASE_INIT_BK3,
+	D350T1013V1_PHASE_VERIFY,
+	D350T1013V1_PHASE_DISPLAY_ON,
+	D350T1013V1_NUM_PHASES,
+};
+
+static const char * const d350t1013v1_phase_names[] = {
+	[D350T1013V1_PHASE_REGULATOR]	= "regulator",
+	[D350T1013V1_PHASE_RESET]		= "reset",
+	[D350T1013V1_PHASE_SOFT_RESET]	= "soft_reset",
+	[D350T1013V1_PHASE_SLEEP_OUT]	= "sleep_out",
+	[D350T1013V1_PHASE_READ_ID]		= "read_id",
+	[D350T1013V1_PHASE_INIT_CMD1]	= "init_cmd1",
+	[D350T1013V1_PHASE_INIT_BK0]	= "init_bk0",
+	[D350T1013V1_PHASE_INIT_BK1]	= "init_bk1",
+	[D350T1013V1_PHASE_INIT_BK2]	= "init_bk2",
+	[D350T1013V1_PHASE_INIT_BK3]	= "init_bk3",
+	[D350T1013V1_PHASE_VERIFY]		= "verify",
+	[D350T1013V1_PHASE_DISPLAY_ON]	= "display_on",
+};
+
+struct d350t1013v1_phase_stats {
+	unsigned int count;
+	s64 min_us;
+	s64 max_us;
+	s64 total_us;
+};
+
+/* Power states, derived from the panel state flags. */
+enum d350t1013v1_state {
+	D350T1013V1_STATE_OFF,
+	D350T1013V1_STATE_SLEEPING,
+	D350T1013V1_STATE_PREPARED,
+	D350T1013V1_STATE_ENABLED,
+	D350T1013V1_STATE_IDLE,
+	D350T1013V1_STATE_PARTIAL,
+	D350T1013V1_NUM_STATES,
+};
+
+static const char * const d350t1013v1_state_names[] = {
+	[D350T1013V1_STATE_OFF]		= "off",
+	[D350T1013V1_STATE_SLEEPING]	= "sleeping",
+	[D350T1013V1_STATE_PREPARED]	= "prepared",
+	[D350T1013V1_STATE_ENABLED]	= "enabled",
+	[D350T1013V1_STATE_IDLE]	= "idle",
+	[D350T1013V1_STATE_PARTIAL]	= "partial",
+};
+
+/* Ways of getting the panel from prepare() to showing the display. */
+enum d350t1013v1_transition {
+	D350T1013V1_TRANSITION_COLD,
+	D350T1013V1_TRANSITION_FAST,
+	D350T1013V1_TRANSITION_HANDOVER,
+	D350T1013V1_TRANSITION_SEAMLESS,
+	D350T1013V1_NUM_TRANSITIONS,
+};
+
+static const char * const d350t1013v1_transition_names[] = {
+	[D350T1013V1_TRANSITION_COLD]		= "cold",
+	[D350T1013V1_TRANSITION_FAST]		= "fast",
+	[D350T1013V1_TRANSITION_HANDOVER]	= "handover",
+	[D350T1013V1_TRANSITION_SEAMLESS]	= "seamless",
+};
+
+/* Stages of a benchmark cycle, replaying unprepare(), prepare() and enable(). */
+enum d350t1013v1_bench_stage {
+	D350T1013V1_BENCH_UNPREPARE,
+	D350T1013V1_BENCH_PREPARE,
+	D350T1013V1_BENCH_ENABLE,
+	D350T1013V1_BENCH_CYCLE,
+	D350T1013V1_NUM_BENCH_STAGES,
+};
+
+static const char * const d350t1013v1_bench_stage_names[] = {
+	[D350T1013V1_BENCH_UNPREPARE]	= "unprepare",
+	[D350T1013V1_BENCH_PREPARE]	= "prepare",
+	[D350T1013V1_BENCH_ENABLE]	= "enable",
+	[D350T1013V1_BENCH_CYCLE]	= "cycle",
+};
+
+#define D350T1013V1_BENCH_MAX_CYCLES	1000
+/* Cycle latency histogram: below 1 ms, then power of two ms buckets. */
+#define D350T1013V1_BENCH_BUCKETS	12
+
+struct d350t1013v1_bench {
+	unsigned int requested;
+	unsigned int dsi_errors;
+	int ret;
+	struct d350t1013v1_phase_stats stages[D350T1013V1_NUM_BENCH_STAGES];
+	unsigned int histogram[D350T1013V1_BENCH_BUCKETS];
+};
+
+#define D350T1013V1_DISPLAY_ID_LEN	3
+
+/* Waits up to this long are spun, longer ones sleep with that slack. */
+#define D350T1013V1_WAIT_SPIN_US	10
+#define D350T1013V1_WAIT_SLACK_US	200
+
+/* WRCTRLD: brightness control block, display dimming and backlight on. */
+#define D350T1013V1_CTRLD_BCTRL		BIT(5)
+#define D350T1013V1_CTRLD_DD		BIT(3)
+#define D350T1013V1_CTRLD_BL		BIT(2)
+
+#define D350T1013V1_MAX_BRIGHTNESS	255
+
+/* Ambient state flags, combined to index d350t1013v1_ambient_names. */
+#define D350T1013V1_AMBIENT_IDLE	BIT(0)
+#define D350T1013V1_AMBIENT_PARTIAL	BIT(1)
+
+struct d350t1013v1 {
+	struct drm_panel panel;
+	struct mipi_dsi_device *dsi;
+	const struct d350t1013v1_panel_desc *desc;
+	struct regulator_bulk_data *supplies;
+	struct gpio_desc *reset;
+	struct d350t1013v1_timings timings;
+	/* Init sequence, loaded from firmware or of the panel description. */
+	const struct d350t1013v1_cmd *init_cmds;
+	unsigned int num_init_cmds;
+	/*
+	 * Earliest time the controller accepts the next command, i.e. the
+	 * end of the settle time of the last bring-up step.
+	 */
+	ktime_t ready_at;
+
+	/* Serializes DCS traffic and the panel state below. */
+	struct mutex lock;
+
+	/* Panel bring-up, possibly running asynchronously to prepare(). */
+	struct work_struct init_work;
+	struct completion init_done;
+	int init_ret;
+
+	/* Supplies are on and reset is released. */
+	bool powered;
+	/* Powered and the init sequence is still programmed. */
+	bool initialized;
+	/* Power off after sleep-in, deferred to keep it out of unprepare(). */
+	struct delayed_work off_work;
+	/* Early power-up started at probe, holding a runtime PM reference. */
+	struct work_struct early_work;
+	bool early_pm;
+	/* Between prepare() and unprepare(), holding a runtime PM reference. */
+	bool prepared;
+	/* Try to take over the panel as configured by the bootloader. */
+	bool handover;
+	/* Display id read during the last bring-up. */
+	u8 display_id[D350T1013V1_DISPLAY_ID_LEN];
+
+	/* Periodic link health check while enabled. */
+	struct delayed_work esd_work;
+	u32 esd_checks;
+	u32 esd_recoveries;
+
+	/* Display switched on, showing mode. */
+	bool enabled;
+	struct drm_display_mode mode;
+	/* Mode switch in progress that keeps the panel running. */
+	bool seamless;
+	struct drm_connector *connector;
+
+	/* Backlight controlled by the DCS brightness and CABC registers. */
+	struct backlight_device *dcs_backlight;
+	unsigned int cabc_mode;
+
+	/* Available profiles, the selected one and the one the panel holds. */
+	struct d350t1013v1_profile *profiles;
+	unsigned int num_profiles;
+	unsigned int profile;
+	unsigned int applied_profile;
+
+	/* Requested ambient state and the rows kept lit in partial mode. */
+	unsigned int ambient;
+	unsigned int partial_start;
+	unsigned int partial_end;
+
+	/* COLMOD value and connector info matching the DSI pixel format. */
+	u8 colmod;
+	u32 bus_format;
+	unsigned int bpc;
+
+	struct dentry *debugfs;
+	struct mutex stats_lock;
+	struct d350t1013v1_phase_stats phase_stats[D350T1013V1_NUM_PHASES];
+	/* Failed write attempts per init command. */
+	unsigned int *cmd_failures;
+	/* Results of the last benchmark run, and whether one is running. */
+	struct d350t1013v1_bench bench;
+	bool bench_running;
+
+	/* Power state residency, protected by stats_lock. */
+	enum d350t1013v1_state state;
+	ktime_t state_since;
+	u32 state_entries[D350T1013V1_NUM_STATES];
+	s64 state_us[D350T1013V1_NUM_STATES];
+	/* Latencies of prepare() and enable() per transition type. */
+	enum d350t1013v1_transition transition;
+	s64 prepare_us;
+	struct d350t1013v1_phase_stats prepare_stats[D350T1013V1_NUM_TRANSITIONS];
+	struct d350t1013v1_phase_stats enable_stats[D350T1013V1_NUM_TRANSITIONS];
+};
+
+static bool async_init;
+module_param(async_init, bool, 0644);
+MODULE_PARM_DESC(async_init, "Bring up the panel in the background, only enable() waits for it");
+
+static bool fast_blank;
+module_param(fast_blank, bool, 0644);
+MODULE_PARM_DESC(fast_blank, "Keep the panel powered and initialized while blanked until autosuspend");
+
+static bool handover;
+module_param(handover, bool, 0444);
+MODULE_PARM_DESC(handover, "Take over a panel already initialized by the bootloader");
+
+static bool early_init;
+module_param(early_init, bool, 0444);
+MODULE_PARM_DESC(early_init, "Power up the panel and release reset at probe, ahead of the first prepare()");
+
+static bool verify_init;
+module_param(verify_init, bool, 0644);
+MODULE_PARM_DESC(verify_init, "Read back critical registers after the init sequence");
+
+static bool hs_init;
+module_param(hs_init, bool, 0644);
+MODULE_PARM_DESC(hs_init, "Send the init sequence in high-speed instead of low-power mode");
+
+static unsigned int write_retries = 2;
+module_param(write_retries, uint, 0644);
+MODULE_PARM_DESC(write_retries, "Number of retries of a failed init command write");
+
+static unsigned int esd_check_ms;
+module_param(esd_check_ms, uint, 0644);
+MODULE_PARM_DESC(esd_check_ms, "Interval of the panel health check in ms (0 = off)");
+
+static bool seamless_modeset;
+module_param(seamless_modeset, bool, 0644);
+MODULE_PARM_DESC(seamless_modeset, "Keep the panel running across switches between modes that only differ in pixel clock");
+
+static int autosuspend_delay_ms = 2000;
+module_param(autosuspend_delay_ms, int, 0444);
+MODULE_PARM_DESC(autosuspend_delay_ms, "Delay before powering off a blanked panel in fast blank mode in ms");
+
+/*
+ * Timing overrides for qualified units. A negative value selects the
+ * default of the panel description.
+ */
+static int supply_ramp_ms = -1;
+module_param(supply_ramp_ms, int, 0444);
+MODULE_PARM_DESC(supply_ramp_ms, "Supply ramp before reset release in ms (-1 = panel default)");
+
+static int reset_ms = -1;
+module_param(reset_ms, int, 0444);
+MODULE_PARM_DESC(reset_ms, "Delay after reset release in ms (-1 = panel default)");
+
+static int soft_reset_ms = -1;
+module_param(soft_reset_ms, int, 0444);
+MODULE_PARM_DESC(soft_reset_ms, "Delay after software reset in ms (-1 = panel default)");
+
+static int sleep_out_ms = -1;
+module_param(sleep_out_ms, int, 0444);
+MODULE_PARM_DESC(sleep_out_ms, "Delay after sleep-out in ms (-1 = panel default)");
+
+static int power_setup_ms = -1;
+module_param(power_setup_ms, int, 0444);
+MODULE_PARM_DESC(power_setup_ms, "Delay after power settings in ms (-1 = panel default)");
+
+static int analog_setup_ms = -1;
+module_param(analog_setup_ms, int, 0444);
+MODULE_PARM_DESC(analog_setup_ms, "Delay after analog settings in ms (-1 = panel default)");
+
+static int colmod_ms = -1;
+module_param(colmod_ms, int, 0444);
+MODULE_PARM_DESC(colmod_ms, "Delay after setting the pixel format in ms (-1 = panel default)");
+
+static int sleep_in_ms = -1;
+module_param(sleep_in_ms, int, 0444);
+MODULE_PARM_DESC(sleep_in_ms, "Delay after sleep-in before power off in ms (-1 = panel default)");
+
+static inline struct d350t1013v1 *panel_to_d350t1013v1(struct drm_panel *panel)
+{
+	return container_of(panel, struct d350t1013v1, panel);
+}
+
+static bool d350t1013v1_is_bksel(const struct d350t1013v1_cmd *cmd)
+{
+	return cmd->len == D350T1013V1_BKSEL_LEN &&
+	       cmd->data[0] == D350T1013V1_BKSEL;
+}
+
+static ktime_t d350t1013v1_phase_begin(struct d350t1013v1 *d350t1013v1,
+				       enum d350t1013v1_phase phase)
+{
+	trace_d350t1013v1_phase_begin(d350t1013v1_phase_names[phase]);
+
+	return ktime_get();
+}
+
+/* Called with stats_lock held. */
+static void d350t1013v1_stats_add(struct d350t1013v1_phase_stats *stats,
+				  s64 duration_us)
+{
+	if (!stats->count || duration_us < stats->min_us)
+		stats->min_us = duration_us;
+	if (duration_us > stats->max_us)
+		stats->max_us = duration_us;
+	stats->total_us += duration_us;
+	stats->count++;
+}
+
+static enum d350t1013v1_state d350t1013v1_get_state(struct d350t1013v1 *d350t1013v1)
+{
+	if (!d350t1013v1->powered)
+		return D350T1013V1_STATE_OFF;
+
+	if (d350t1013v1->enabled) {
+		if (d350t1013v1->ambient & D350T1013V1_AMBIENT_PARTIAL)
+			return D350T1013V1_STATE_PARTIAL;
+		if (d350t1013v1->ambient & D350T1013V1_AMBIENT_IDLE)
+			return D350T1013V1_STATE_IDLE;
+		return D350T1013V1_STATE_ENABLED;
+	}
+
+	if (d350t1013v1->prepared)
+		return D350T1013V1_STATE_PREPARED;
+
+	return D350T1013V1_STATE_SLEEPING;
+}
+
+/* Accounts the time spent in the previous state. Called on changes. */
+static void d350t1013v1_update_state(struct d350t1013v1 *d350t1013v1)
+{
+	enum d350t1013v1_state state = d350t1013v1_get_state(d350t1013v1);
+	ktime_t now = ktime_get();
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	if (state != d350t1013v1->state) {
+		d350t1013v1->state_us[d350t1013v1->state] +=
+			ktime_us_delta(now, d350t1013v1->state_since);
+		d350t1013v1->state = state;
+		d350t1013v1->state_since = now;
+		d350t1013v1->state_entries[state]++;
+	}
+	mutex_unlock(&d350t1013v1->stats_lock);
+}
+
+static void d350t1013v1_phase_end(struct d350t1013v1 *d350t1013v1,
+				  enum d350t1013v1_phase phase, ktime_t start,
+				  int ret)
+{
+	struct d350t1013v1_phase_stats *stats = &d350t1013v1->phase_stats[phase];
+	s64 duration_us = ktime_us_delta(ktime_get(), start);
+
+	trace_d350t1013v1_phase_end(d350t1013v1_phase_names[phase],
+				    duration_us, ret);
+	if (ret < 0)
+		return;
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	d350t1013v1_stats_add(stats, duration_us);
+	mutex_unlock(&d350t1013v1->stats_lock);
+}
+
+/* Init commands are accounted to the phase of their command 2 bank. */
+static enum d350t1013v1_phase d350t1013v1_bank_phase(u8 bank)
+{
+	if (bank >= 0x10 && bank <= 0x13)
+		return D350T1013V1_PHASE_INIT_BK0 + (bank - 0x10);
+
+	return D350T1013V1_PHASE_INIT_CMD1;
+}
+
+/* Time base of the settle times, the tests replace it by a virtual clock. */
+static ktime_t d350t1013v1_clock(struct d350t1013v1 *d350t1013v1)
+{
+	KUNIT_STATIC_STUB_REDIRECT(d350t1013v1_clock, d350t1013v1);
+
+	return ktime_get();
+}
+
+/*
+ * msleep() rounds up to jiffies and fsleep() allows up to twice the
+ * requested time, so all waits use hrtimer based sleeps with a small
+ * fixed slack instead.
+ */
+static void d350t1013v1_sleep_us(struct d350t1013v1 *d350t1013v1, s64 us)
+{
+	KUNIT_STATIC_STUB_REDIRECT(d350t1013v1_sleep_us, d350t1013v1, us);
+
+	if (us <= D350T1013V1_WAIT_SPIN_US)
+		udelay(us);
+	else
+		usleep_range(us, us + D350T1013V1_WAIT_SLACK_US);
+}
+
+/*
+ * Bring-up steps don't sleep for their settle time. Instead they record
+ * when the controller becomes ready, and only the next dependent step
+ * waits for the remaining time. Work done in between, e.g. by the DSI
+ * host between prepare() and enable(), overlaps with the settle time.
+ */
+static void d350t1013v1_settle(struct d350t1013v1 *d350t1013v1,
+			       unsigned int ms)
+{
+	ktime_t ready_at = ktime_add_ms(d350t1013v1_clock(d350t1013v1), ms);
+
+	if (ktime_after(ready_at, d350t1013v1->ready_at))
+		d350t1013v1->ready_at = ready_at;
+}
+
+/* Waits for the controller to become ready. */
+static void d350t1013v1_wait_ready(struct d350t1013v1 *d350t1013v1)
+{
+	ktime_t start = d350t1013v1_clock(d350t1013v1);
+	s64 remaining_us = ktime_us_delta(d350t1013v1->ready_at, start);
+
+	if (remaining_us <= 0)
+		return;
+
+	d350t1013v1_sleep_us(d350t1013v1, remaining_us);
+
+	trace_d350t1013v1_wait(remaining_us,
+			       ktime_us_delta(d350t1013v1_clock(d350t1013v1), start));
+}
+
+static void d350t1013v1_delay(struct d350t1013v1 *d350t1013v1,
+			      enum d350t1013v1_delay delay)
+{
+	const struct d350t1013v1_timings *timings = &d350t1013v1->timings;
+
+	switch (delay) {
+	case D350T1013V1_DELAY_NONE:
+		break;
+	case D350T1013V1_DELAY_SLEEP_OUT:
+		d350t1013v1_settle(d350t1013v1, timings->sleep_out_ms);
+		break;
+	case D350T1013V1_DELAY_POWER_SETUP:
+		d350t1013v1_settle(d350t1013v1, timings->power_setup_ms);
+		break;
+	case D350T1013V1_DELAY_ANALOG_SETUP:
+		d350t1013v1_settle(d350t1013v1, timings->analog_setup_ms);
+		break;
+	}
+}
+
+/*
+ * Writes a single command, retrying it a bounded number of times. Each
+ * failed attempt is counted in failures, if given.
+ */
+static int d350t1013v1_write(struct d350t1013v1 *d350t1013v1,
+			     const struct d350t1013v1_cmd *cmd,
+			     unsigned int *failures)
+{
+	unsigned int attempt;
+	ssize_t ret;
+
+	for (attempt = 0; ; attempt++) {
+		ret = mipi_dsi_dcs_write_buffer(d350t1013v1->dsi, cmd->data,
+						cmd->len);
+		if (ret >= 0)
+			return 0;
+
+		if (failures)
+			(*failures)++;
+		if (attempt >= write_retries)
+			return ret;
+	}
+}
+
+/*
+ * Sends a batch of consecutive commands without delays in between, so
+ * that they leave the host back to back.
+ */
+static int d350t1013v1_send_batch(struct d350t1013v1 *d350t1013v1,
+				  const struct d350t1013v1_cmd *cmds,
+				  unsigned int num_cmds, unsigned int *failures)
+{
+	ktime_t start;
+	unsigned int i;
+	int ret;
+
+	if (!num_cmds)
+		return 0;
+
+	d350t1013v1_wait_ready(d350t1013v1);
+	start = ktime_get();
+
+	for (i = 0; i < num_cmds; i++) {
+		ret = d350t1013v1_write(d350t1013v1, &cmds[i],
+					failures ? &failures[i] : NULL);
+		if (ret < 0) {
+			dev_err(&d350t1013v1->dsi->dev,
+				"command %02x failed: %d\n", cmds[i].data[0], ret);
+			return ret;
+		}
+	}
+
+	dev_dbg(&d350t1013v1->dsi->dev, "sent %u commands in %lld us\n",
+		num_cmds, ktime_us_delta(ktime_get(), start));
+
+	return 0;
+}
+
+/*
+ * Executes a command table. Runs of commands without post-delay are
+ * queued as one batch, the next batch waits for the delay of the last
+ * command. Bank selects start a new batch and phase. Execution stops at
+ * the first command that fails after its retries. failures, if given,
+ * holds one counter per command.
+ */
+static int d350t1013v1_run_cmds(struct d350t1013v1 *d350t1013v1,
+				const struct d350t1013v1_cmd *cmds,
+				unsigned int num_cmds, unsigned int *failures)
+{
+	enum d350t1013v1_phase phase = D350T1013V1_PHASE_INIT_CMD1;
+	ktime_t phase_start = d350t1013v1_phase_begin(d350t1013v1, phase);
+	unsigned int start = 0, i;
+	int ret = 0;
+
+	for (i = 0; i < num_cmds; i++) {
+		if (d350t1013v1_is_bksel(&cmds[i])) {
+			ret = d350t1013v1_send_batch(d350t1013v1, &cmds[start], i - start,
+						     failures ? &failures[start] : NULL);
+			if (ret < 0)
+				goto out;
+			start = i;
+
+			d350t1013v1_phase_end(d350t1013v1, phase, phase_start, 0);
+			phase = d350t1013v1_bank_phase(cmds[i].data[D350T1013V1_BKSEL_LEN - 1]);
+			phase_start = d350t1013v1_phase_begin(d350t1013v1, phase);
+		}
+
+		if (cmds[i].delay == D350T1013V1_DELAY_NONE && i + 1 < num_cmds)
+			continue;
+
+		ret = d350t1013v1_send_batch(d350t1013v1, &cmds[start], i + 1 - start,
+					     failures ? &failures[start] : NULL);
+		if (ret < 0)
+			goto out;
+		d350t1013v1_delay(d350t1013v1, cmds[i].delay);
+		start = i + 1;
+	}
+
+out:
+	d350t1013v1_phase_end(d350t1013v1, phase, phase_start, ret);
+	return ret;
+}
+
+static int d350t1013v1_select_bank(struct d350t1013v1 *d350t1013v1, u8 bank)
+{
+	const u8 data[D350T1013V1_BKSEL_LEN] = {
+		D350T1013V1_BKSEL, 0x77, 0x01, 0x00, 0x00, bank,
+	};
+	const struct d350t1013v1_cmd cmd = {
+		.data = data,
+		.len = sizeof(data),
+	};
+
+	return d350t1013v1_write(d350t1013v1, &cmd, NULL);
+}
+
+/*
+ * Programs the selected gamma and power profile, unless the panel already
+ * holds it, and returns to command 1.
+ */
+static int d350t1013v1_apply_profile(struct d350t1013v1 *d350t1013v1)
+{
+	const struct d350t1013v1_profile *profile =
+		&d350t1013v1->profiles[d350t1013v1->profile];
+	int ret;
+
+	if (d350t1013v1->applied_profile == d350t1013v1->profile)
+		return 0;
+
+	/* Profiles have no delays and aren't accounted to the bring-up. */
+	ret = d350t1013v1_send_batch(d350t1013v1, profile->cmds,
+				     profile->num_cmds, NULL);
+	if (ret == 0)
+		ret = d350t1013v1_select_bank(d350t1013v1, D350T1013V1_BANK_NONE);
+	if (ret < 0)
+		return ret;
+
+	d350t1013v1->applied_profile = d350t1013v1->profile;
+
+	return 0;
+}
+
+/*
+ * Sends the init sequence to a panel out of sleep mode, whose link has
+ * been checked by reading from it.
+ */
+static int d350t1013v1_init_sequence(struct d350t1013v1 *d350t1013v1)
+{
+	struct mipi_dsi_device *dsi = d350t1013v1->dsi;
+	unsigned long mode_flags = dsi->mode_flags;
+	int ret;
+
+	/* The DSI core picks the transfer mode per message from the flags. */
+	if (hs_init)
+		dsi->mode_flags &= ~MIPI_DSI_MODE_LPM;
+
+	ret = d350t1013v1_run_cmds(d350t1013v1, d350t1013v1->init_cmds,
+				   d350t1013v1->num_init_cmds, d350t1013v1->cmd_failures);
+	if (ret < 0)
+		goto out;
+
+	/* The init sequence itself programs the default profile. */
+	d350t1013v1->applied_profile = D350T1013V1_PROFILE_DEFAULT;
+	ret = d350t1013v1_apply_profile(d350t1013v1);
+	if (ret < 0)
+		goto out;
+
+	d350t1013v1_wait_ready(d350t1013v1);
+	ret = mipi_dsi_dcs_set_pixel_format(dsi, d350t1013v1->colmod);
+	if (ret < 0)
+		goto out;
+	d350t1013v1_settle(d350t1013v1, d350t1013v1->timings.colmod_ms);
+
+out:
+	dsi->mode_flags = mode_flags;
+	return ret < 0 ? ret : 0;
+}
+
+/* Command 2 registers read back by the init verification. */
+static const struct {
+	u8 bank;
+	u8 opcode;
+} d350t1013v1_verify_regs[] = {
+	/* Display line setting, porch control and inversion selection. */
+	{ 0x10, 0xC0 },
+	{ 0x10, 0xC1 },
+	{ 0x10, 0xC2 },
+};
+
+#define D350T1013V1_VERIFY_MAX_LEN	16
+
+/*
+ * Finds the last write of a command 2 register in the init sequence and
+ * the bank segment containing it, from its bank select up to the next.
+ */
+static int d350t1013v1_find_cmd(struct d350t1013v1 *d350t1013v1, u8 bank,
+				u8 opcode, unsigned int *seg_start,
+				unsigned int *seg_end)
+{
+	const struct d350t1013v1_cmd *cmds = d350t1013v1->init_cmds;
+	u8 cur = D350T1013V1_BANK_NONE;
+	unsigned int i, start = 0;
+	int found = -ENOENT;
+
+	for (i = 0; i < d350t1013v1->num_init_cmds; i++) {
+		if (d350t1013v1_is_bksel(&cmds[i])) {
+			if (found >= 0 && *seg_start == start)
+				*seg_end = i;
+			cur = cmds[i].data[D350T1013V1_BKSEL_LEN - 1];
+			start = i;
+		} else if (cur == bank && cmds[i].data[0] == opcode) {
+			found = i;
+			*seg_start = start;
+			*seg_end = d350t1013v1->num_init_cmds;
+		}
+	}
+
+	return found;
+}
+
+/* Returns 1 if the register doesn't hold the value of the command. */
+static int d350t1013v1_check_reg(struct d350t1013v1 *d350t1013v1, u8 bank,
+				 const struct d350t1013v1_cmd *cmd)
+{
+	u8 value[D350T1013V1_VERIFY_MAX_LEN];
+	size_t len = cmd->len - 1;
+	int ret;
+
+	ret = d350t1013v1_select_bank(d350t1013v1, bank);
+	if (ret < 0)
+		return ret;
+
+	ret = mipi_dsi_dcs_read(d350t1013v1->dsi, cmd->data[0], value, len);
+	if (ret >= 0)
+		ret = ret != len || memcmp(value, &cmd->data[1], len);
+
+	if (d350t1013v1_select_bank(d350t1013v1, D350T1013V1_BANK_NONE) < 0 &&
+	    ret >= 0)
+		ret = -EIO;
+
+	return ret;
+}
+
+/*
+ * Reads back a few registers to check that the panel took the init
+ * sequence. A command 2 bank with a wrong register is sent again, the
+ * rest of the sequence is left alone.
+ */
+static int d350t1013v1_verify_init(struct d350t1013v1 *d350t1013v1)
+{
+	struct mipi_dsi_device *dsi = d350t1013v1->dsi;
+	struct device *dev = &dsi->dev;
+	unsigned int i, attempt, seg_start, seg_end;
+	u8 bank, mode, format;
+	int idx, ret = 0;
+
+	d350t1013v1_wait_ready(d350t1013v1);
+
+	for (i = 0; i < ARRAY_SIZE(d350t1013v1_verify_regs); i++) {
+		bank = d350t1013v1_verify_regs[i].bank;
+		idx = d350t1013v1_find_cmd(d350t1013v1, bank,
+					   d350t1013v1_verify_regs[i].opcode,
+					   &seg_start, &seg_end);
+		if (idx < 0 ||
+		    d350t1013v1->init_cmds[idx].len - 1 > D350T1013V1_VERIFY_MAX_LEN)
+			continue;
+
+		for (attempt = 0; ; attempt++) {
+			ret = d350t1013v1_check_reg(d350t1013v1, bank,
+						    &d350t1013v1->init_cmds[idx]);
+			if (ret <= 0)
+				break;
+			if (attempt) {
+				ret = -EIO;
+				break;
+			}
+
+			dev_warn(dev, "register %02x of bank %02x not taken, resending bank\n",
+				 d350t1013v1->init_cmds[idx].data[0], bank);
+			ret = d350t1013v1_run_cmds(d350t1013v1,
+						   &d350t1013v1->init_cmds[seg_start],
+						   seg_end - seg_start,
+						   &d350t1013v1->cmd_failures[seg_start]);
+			if (ret == 0)
+				ret = d350t1013v1_select_bank(d350t1013v1,
+							      D350T1013V1_BANK_NONE);
+			if (ret < 0)
+				break;
+			/* The bank may have overwritten profile registers. */
+			d350t1013v1->applied_profile = D350T1013V1_PROFILE_UNKNOWN;
+			d350t1013v1_wait_ready(d350t1013v1);
+		}
+		if (ret < 0)
+			return ret;
+	}
+
+	for (attempt = 0; ; attempt++) {
+		ret = mipi_dsi_dcs_get_pixel_format(dsi, &format);
+		if (ret < 0)
+			return ret;
+		if (format == d350t1013v1->colmod)
+			break;
+		if (attempt)
+			return -EIO;
+
+		dev_warn(dev, "pixel format %02x not taken, resending\n",
+			 d350t1013v1->colmod);
+		ret = mipi_dsi_dcs_set_pixel_format(dsi, d350t1013v1->colmod);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = mipi_dsi_dcs_get_power_mode(dsi, &mode);
+	if (ret < 0)
+		return ret;
+	if (!(mode & MIPI_DCS_POWER_MODE_SLEEP)) {
+		dev_err(dev, "panel still in sleep mode (mode %02x)\n", mode);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void d350t1013v1_power_off(struct d350t1013v1 *d350t1013v1)
+{
+	/* Failed bring-up and recovery paths already powered off. */
+	if (!d350t1013v1->powered)
+		return;
+
+	/* Lets a pending sleep-in complete before the supply is cut. */
+	d350t1013v1_wait_ready(d350t1013v1);
+	gpiod_set_value(d350t1013v1->reset, 0);
+	regulator_bulk_disable(d350t1013v1->desc->num_supplies, d350t1013v1->supplies);
+	d350t1013v1->powered = false;
+	d350t1013v1->initialized = false;
+	d350t1013v1_update_state(d350t1013v1);
+}
+
+/* Switches the supplies on and releases reset. */
+static int d350t1013v1_power_up(struct d350t1013v1 *d350t1013v1)
+{
+	const struct d350t1013v1_timings *timings = &d350t1013v1->timings;
+	ktime_t start;
+	int ret;
+
+	gpiod_set_value(d350t1013v1->reset, 0);
+
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_REGULATOR);
+	ret = regulator_bulk_enable(d350t1013v1->desc->num_supplies,
+				    d350t1013v1->supplies);
+	if (ret < 0) {
+		d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_REGULATOR, start, ret);
+		return ret;
+	}
+	d350t1013v1_settle(d350t1013v1, timings->supply_ramp_ms);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_REGULATOR, start, 0);
+
+	/*
+	 * Each step waits for the settle time of the previous one, which is
+	 * accounted to the phase of the waiting step.
+	 */
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_RESET);
+	d350t1013v1_wait_ready(d350t1013v1);
+	gpiod_set_value(d350t1013v1->reset, 1);
+	d350t1013v1_settle(d350t1013v1, timings->reset_ms);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_RESET, start, 0);
+
+	d350t1013v1->powered = true;
+	d350t1013v1_update_state(d350t1013v1);
+
+	return 0;
+}
+
+/* Wakes a panel that kept its supply and register state while blanked. */
+static int d350t1013v1_fast_resume(struct d350t1013v1 *d350t1013v1)
+{
+	ktime_t start;
+	int ret;
+
+	d350t1013v1_wait_ready(d350t1013v1);
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_SLEEP_OUT);
+	ret = mipi_dsi_dcs_exit_sleep_mode(d350t1013v1->dsi);
+	if (ret == 0)
+		d350t1013v1_settle(d350t1013v1, d350t1013v1->timings.sleep_out_ms);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_SLEEP_OUT, start, ret);
+
+	return ret;
+}
+
+/*
+ * Checks whether the bootloader left the panel in the state our init
+ * sequence produces. If so, the panel is adopted as initialized without
+ * reset, so that a splash screen stays visible.
+ */
+static int d350t1013v1_take_over(struct d350t1013v1 *d350t1013v1)
+{
+	const struct d350t1013v1_panel_desc *desc = d350t1013v1->desc;
+	struct device *dev = &d350t1013v1->dsi->dev;
+	u8 *ids = d350t1013v1->display_id;
+	u8 mode, format;
+	int ret;
+
+	/* Take our reference on the supply the bootloader left enabled. */
+	ret = regulator_bulk_enable(desc->num_supplies, d350t1013v1->supplies);
+	if (ret < 0)
+		return ret;
+
+	ret = mipi_dsi_dcs_read(d350t1013v1->dsi, MIPI_DCS_GET_DISPLAY_ID,
+				ids, D350T1013V1_DISPLAY_ID_LEN);
+	if (ret < 0)
+		goto err_disable;
+
+	ret = mipi_dsi_dcs_get_power_mode(d350t1013v1->dsi, &mode);
+	if (ret < 0)
+		goto err_disable;
+
+	ret = mipi_dsi_dcs_get_pixel_format(d350t1013v1->dsi, &format);
+	if (ret < 0)
+		goto err_disable;
+
+	if (!(mode & MIPI_DCS_POWER_MODE_SLEEP) ||
+	    !(mode & MIPI_DCS_POWER_MODE_NORMAL) || format != d350t1013v1->colmod) {
+		dev_info(dev, "panel not configured by bootloader (mode %02x, format %02x)\n",
+			 mode, format);
+		ret = -ENODEV;
+		goto err_disable;
+	}
+
+	dev_info(dev, "taking over panel, display id: %02x %02x %02x\n",
+		 ids[0], ids[1], ids[2]);
+	d350t1013v1->powered = true;
+	d350t1013v1->initialized = true;
+	d350t1013v1->transition = D350T1013V1_TRANSITION_HANDOVER;
+
+	return 0;
+
+err_disable:
+	regulator_bulk_disable(desc->num_supplies, d350t1013v1->supplies);
+	return ret;
+}
+
+static int d350t1013v1_power_on(struct d350t1013v1 *d350t1013v1)
+{
+	const struct d350t1013v1_timings *timings = &d350t1013v1->timings;
+	u8 *ids = d350t1013v1->display_id;
+	ktime_t start;
+	int ret;
+
+	if (d350t1013v1->initialized) {
+		ret = d350t1013v1_fast_resume(d350t1013v1);
+		if (ret == 0) {
+			d350t1013v1->transition = D350T1013V1_TRANSITION_FAST;
+			return 0;
+		}
+
+		dev_warn(&d350t1013v1->dsi->dev,
+			 "fast resume failed (%d), reinitializing\n", ret);
+		d350t1013v1_power_off(d350t1013v1);
+	}
+
+	if (d350t1013v1->handover) {
+		d350t1013v1->handover = false;
+		if (d350t1013v1_take_over(d350t1013v1) == 0)
+			return 0;
+	}
+
+	/* An early power-up at probe may already have released reset. */
+	if (!d350t1013v1->powered) {
+		ret = d350t1013v1_power_up(d350t1013v1);
+		if (ret < 0)
+			return ret;
+	}
+
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_SOFT_RESET);
+	d350t1013v1_wait_ready(d350t1013v1);
+	ret = mipi_dsi_dcs_soft_reset(d350t1013v1->dsi);
+	if (ret == 0)
+		d350t1013v1_settle(d350t1013v1, timings->soft_reset_ms);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_SOFT_RESET, start, ret);
+	if (ret < 0)
+		goto err_power_off;
+
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_SLEEP_OUT);
+	d350t1013v1_wait_ready(d350t1013v1);
+	ret = mipi_dsi_dcs_exit_sleep_mode(d350t1013v1->dsi);
+	if (ret == 0)
+		d350t1013v1_settle(d350t1013v1, timings->sleep_out_ms);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_SLEEP_OUT, start, ret);
+	if (ret < 0)
+		goto err_power_off;
+
+	/* Reading the display id ensures that the DSI link is working. */
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_READ_ID);
+	d350t1013v1_wait_ready(d350t1013v1);
+	ret = mipi_dsi_dcs_read(d350t1013v1->dsi, MIPI_DCS_GET_DISPLAY_ID,
+							ids, D350T1013V1_DISPLAY_ID_LEN);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_READ_ID, start, ret);
+	if (ret < 0)
+		goto err_power_off;
+	dev_info(&d350t1013v1->dsi->dev, "display id: %02x %02x %02x\n",
+			ids[0], ids[1], ids[2]);
+
+	/*
+	 * The settle time of the last init command is left pending, enable()
+	 * waits for it while the DSI host finishes its own bring-up.
+	 */
+	ret = d350t1013v1_init_sequence(d350t1013v1);
+	if (ret < 0) {
+		dev_err(&d350t1013v1->dsi->dev, "init sequence failed: %d\n", ret);
+		goto err_power_off;
+	}
+
+	if (verify_init) {
+		start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_VERIFY);
+		ret = d350t1013v1_verify_init(d350t1013v1);
+		d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_VERIFY, start, ret);
+		if (ret < 0) {
+			dev_err(&d350t1013v1->dsi->dev,
+				"init verification failed: %d\n", ret);
+			goto err_power_off;
+		}
+	}
+	d350t1013v1->initialized = true;
+	d350t1013v1->transition = D350T1013V1_TRANSITION_COLD;
+
+	return 0;
+
+err_power_off:
+	d350t1013v1_power_off(d350t1013v1);
+	return ret;
+}
+
+/*
+ * Powers up the panel at probe, so that the supply ramp and reset hold
+ * are over when DRM first prepares the panel. The DCS part of the
+ * bring-up needs the DSI host and is left to prepare().
+ */
+static void d350t1013v1_early_work(struct work_struct *work)
+{
+	struct d350t1013v1 *d350t1013v1 =
+		container_of(work, struct d350t1013v1, early_work);
+	int ret = 0;
+
+	mutex_lock(&d350t1013v1->lock);
+	if (!d350t1013v1->powered)
+		ret = d350t1013v1_power_up(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	if (ret < 0)
+		dev_warn(&d350t1013v1->dsi->dev, "early power-up failed: %d\n", ret);
+}
+
+/* Hands the runtime PM reference of the early power-up over to the caller. */
+static bool d350t1013v1_take_early_pm(struct d350t1013v1 *d350t1013v1)
+{
+	if (!d350t1013v1->early_pm)
+		return false;
+
+	flush_work(&d350t1013v1->early_work);
+	d350t1013v1->early_pm = false;
+
+	return true;
+}
+
+static void d350t1013v1_init_work(struct work_struct *work)
+{
+	struct d350t1013v1 *d350t1013v1 =
+		container_of(work, struct d350t1013v1, init_work);
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->init_ret = d350t1013v1_power_on(d350t1013v1);
+	if (d350t1013v1->init_ret < 0)
+		dev_err(&d350t1013v1->dsi->dev, "panel bring-up failed: %d\n",
+			d350t1013v1->init_ret);
+	mutex_unlock(&d350t1013v1->lock);
+
+	complete_all(&d350t1013v1->init_done);
+}
+
+/*
+ * Returns the mode of the commit being applied, or NULL if it turns the
+ * panel off. The panel callbacks run from the commit tail, where the
+ * connector already points to the new state.
+ */
+static const struct drm_display_mode *
+d350t1013v1_commit_mode(struct d350t1013v1 *d350t1013v1)
+{
+	struct drm_connector *connector = d350t1013v1->connector;
+	struct drm_crtc_state *crtc_state;
+
+	if (!connector || !connector->state || !connector->state->crtc)
+		return NULL;
+
+	crtc_state = connector->state->crtc->state;
+	if (!crtc_state || !crtc_state->active)
+		return NULL;
+
+	return &crtc_state->adjusted_mode;
+}
+
+/*
+ * Modes that only differ in pixel clock are driven by the host timing
+ * alone, so the panel can stay in normal display mode while the host
+ * switches between them. A modeset to the very same mode is a request
+ * for a full cycle and is not skipped.
+ */
+static bool d350t1013v1_is_seamless(struct d350t1013v1 *d350t1013v1)
+{
+	const struct drm_display_mode *mode = d350t1013v1_commit_mode(d350t1013v1);
+
+	return seamless_modeset && d350t1013v1->enabled && mode &&
+	       drm_mode_match(mode, &d350t1013v1->mode, DRM_MODE_MATCH_TIMINGS) &&
+	       !drm_mode_match(mode, &d350t1013v1->mode, DRM_MODE_MATCH_CLOCK);
+}
+
+static int d350t1013v1_prepare(struct drm_panel *panel)
+{
+	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	struct device *dev = &d350t1013v1->dsi->dev;
+	ktime_t start = ktime_get();
+	int ret;
+
+	if (d350t1013v1->seamless) {
+		d350t1013v1->prepare_us = 0;
+		return 0;
+	}
+
+	if (!d350t1013v1_take_early_pm(d350t1013v1)) {
+		ret = pm_runtime_resume_and_get(dev);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* A panel blanked within the sleep-in time is still initialized. */
+	cancel_delayed_work_sync(&d350t1013v1->off_work);
+
+	if (async_init) {
+		d350t1013v1->prepared = true;
+		d350t1013v1_update_state(d350t1013v1);
+		reinit_completion(&d350t1013v1->init_done);
+		queue_work(system_unbound_wq, &d350t1013v1->init_work);
+		d350t1013v1->prepare_us = ktime_us_delta(ktime_get(), start);
+		return 0;
+	}
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->init_ret = d350t1013v1_power_on(d350t1013v1);
+	if (d350t1013v1->init_ret == 0)
+		d350t1013v1->prepared = true;
+	d350t1013v1_update_state(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	if (d350t1013v1->init_ret < 0) {
+		pm_runtime_put_autosuspend(dev);
+		return d350t1013v1->init_ret;
+	}
+
+	d350t1013v1->prepare_us = ktime_us_delta(ktime_get(), start);
+
+	return 0;
+}
+
+static void d350t1013v1_update_mode(struct d350t1013v1 *d350t1013v1)
+{
+	const struct drm_display_mode *mode = d350t1013v1_commit_mode(d350t1013v1);
+
+	if (mode)
+		drm_mode_copy(&d350t1013v1->mode, mode);
+}
+
+/*
+ * Programs the requested ambient state: idle mode reduces the color depth
+ * to 8 colors, partial mode only keeps the configured rows lit.
+ */
+static int d350t1013v1_apply_ambient(struct d350t1013v1 *d350t1013v1)
+{
+	struct mipi_dsi_device *dsi = d350t1013v1->dsi;
+	unsigned int ambient = d350t1013v1->ambient;
+	u8 rows[4];
+	int ret;
+
+	if (ambient & D350T1013V1_AMBIENT_PARTIAL) {
+		rows[0] = d350t1013v1->partial_start >> 8;
+		rows[1] = d350t1013v1->partial_start & 0xff;
+		rows[2] = d350t1013v1->partial_end >> 8;
+		rows[3] = d350t1013v1->partial_end & 0xff;
+
+		ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_SET_PARTIAL_ROWS,
+					 rows, sizeof(rows));
+		if (ret < 0)
+			return ret;
+
+		ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_ENTER_PARTIAL_MODE, NULL, 0);
+	} else {
+		ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_ENTER_NORMAL_MODE, NULL, 0);
+	}
+	if (ret < 0)
+		return ret;
+
+	if (ambient & D350T1013V1_AMBIENT_IDLE)
+		ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_ENTER_IDLE_MODE, NULL, 0);
+	else
+		ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_EXIT_IDLE_MODE, NULL, 0);
+
+	return ret < 0 ? ret : 0;
+}
+
+/* Programs the DCS brightness and content adaptive brightness control. */
+static int d350t1013v1_apply_backlight(struct d350t1013v1 *d350t1013v1)
+{
+	struct mipi_dsi_device *dsi = d350t1013v1->dsi;
+	u8 ctrl = D350T1013V1_CTRLD_BCTRL | D350T1013V1_CTRLD_DD |
+		  D350T1013V1_CTRLD_BL;
+	u8 cabc = d350t1013v1->cabc_mode;
+	int ret;
+
+	ret = mipi_dsi_dcs_set_display_brightness(dsi,
+		backlight_get_brightness(d350t1013v1->dcs_backlight));
+	if (ret < 0)
+		return ret;
+
+	ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_WRITE_CONTROL_DISPLAY,
+				 &ctrl, sizeof(ctrl));
+	if (ret < 0)
+		return ret;
+
+	ret = mipi_dsi_dcs_write(dsi, MIPI_DCS_WRITE_POWER_SAVE,
+				 &cabc, sizeof(cabc));
+
+	return ret < 0 ? ret : 0;
+}
+
+static int d350t1013v1_display_on(struct d350t1013v1 *d350t1013v1)
+{
+	ktime_t start;
+	int ret;
+
+	start = d350t1013v1_phase_begin(d350t1013v1, D350T1013V1_PHASE_DISPLAY_ON);
+	d350t1013v1_wait_ready(d350t1013v1);
+	ret = mipi_dsi_dcs_set_display_on(d350t1013v1->dsi);
+	d350t1013v1_phase_end(d350t1013v1, D350T1013V1_PHASE_DISPLAY_ON, start, ret);
+	if (ret < 0)
+		return ret;
+
+	/* A profile selected while the panel was off is applied now. */
+	ret = d350t1013v1_apply_profile(d350t1013v1);
+	if (ret < 0)
+		dev_warn(&d350t1013v1->dsi->dev,
+			 "failed to apply profile: %d\n", ret);
+
+	/* A fast resumed panel may still be in a previous ambient state. */
+	ret = d350t1013v1_apply_ambient(d350t1013v1);
+	if (ret < 0)
+		dev_warn(&d350t1013v1->dsi->dev,
+			 "failed to apply ambient mode: %d\n", ret);
+
+	if (d350t1013v1->dcs_backlight) {
+		ret = d350t1013v1_apply_backlight(d350t1013v1);
+		if (ret < 0)
+			dev_warn(&d350t1013v1->dsi->dev,
+				 "failed to apply backlight: %d\n", ret);
+	}
+
+	return 0;
+}
+
+static void d350t1013v1_esd_schedule(struct d350t1013v1 *d350t1013v1)
+{
+	unsigned int interval = READ_ONCE(esd_check_ms);
+
+	if (interval)
+		schedule_delayed_work(&d350t1013v1->esd_work,
+				      msecs_to_jiffies(interval));
+}
+
+/*
+ * Recovers a panel that lost its state, e.g. after an ESD event. Only the
+ * steps that the readback shows to be necessary are performed: switching
+ * the display back on, re-sending the init sequence, or a full power
+ * cycle if the controller no longer responds properly.
+ */
+static int d350t1013v1_esd_recover(struct d350t1013v1 *d350t1013v1)
+{
+	struct device *dev = &d350t1013v1->dsi->dev;
+	u8 ids[D350T1013V1_DISPLAY_ID_LEN];
+	u8 mode, format;
+	int ret;
+
+	ret = mipi_dsi_dcs_read(d350t1013v1->dsi, MIPI_DCS_GET_DISPLAY_ID,
+				ids, sizeof(ids));
+	if (ret < 0 || memcmp(ids, d350t1013v1->display_id, sizeof(ids)))
+		goto power_cycle;
+
+	ret = mipi_dsi_dcs_get_power_mode(d350t1013v1->dsi, &mode);
+	if (ret < 0)
+		goto power_cycle;
+
+	/* Being back in sleep mode means the controller was reset. */
+	if (!(mode & MIPI_DCS_POWER_MODE_SLEEP))
+		goto power_cycle;
+
+	ret = mipi_dsi_dcs_get_pixel_format(d350t1013v1->dsi, &format);
+	if (ret < 0)
+		goto power_cycle;
+
+	if (format != d350t1013v1->colmod) {
+		dev_warn(dev, "panel lost its configuration, reinitializing\n");
+		ret = d350t1013v1_init_sequence(d350t1013v1);
+		if (ret < 0)
+			goto power_cycle;
+		return d350t1013v1_display_on(d350t1013v1);
+	}
+
+	if (!(mode & MIPI_DCS_POWER_MODE_DISPLAY)) {
+		dev_warn(dev, "panel display switched off, switching on\n");
+		return d350t1013v1_display_on(d350t1013v1);
+	}
+
+	/* Healthy. */
+	return 1;
+
+power_cycle:
+	dev_warn(dev, "panel not responding properly, power cycling\n");
+	d350t1013v1_power_off(d350t1013v1);
+	ret = d350t1013v1_power_on(d350t1013v1);
+	if (ret < 0)
+		return ret;
+
+	return d350t1013v1_display_on(d350t1013v1);
+}
+
+static void d350t1013v1_esd_work(struct work_struct *work)
+{
+	struct d350t1013v1 *d350t1013v1 =
+		container_of(to_delayed_work(work), struct d350t1013v1, esd_work);
+	int ret;
+
+	mutex_lock(&d350t1013v1->lock);
+	/* Don't probe the panel while the host re-times the link. */
+	if (!d350t1013v1->enabled || d350t1013v1->seamless) {
+		mutex_unlock(&d350t1013v1->lock);
+		return;
+	}
+
+	d350t1013v1->esd_checks++;
+	ret = d350t1013v1_esd_recover(d350t1013v1);
+	if (ret == 0)
+		d350t1013v1->esd_recoveries++;
+	if (ret < 0) {
+		/* Leave the panel off, the next modeset brings it up again. */
+		dev_err(&d350t1013v1->dsi->dev, "panel recovery failed: %d\n", ret);
+		d350t1013v1_power_off(d350t1013v1);
+		d350t1013v1->enabled = false;
+		d350t1013v1->init_ret = ret;
+		d350t1013v1_update_state(d350t1013v1);
+	}
+	mutex_unlock(&d350t1013v1->lock);
+
+	if (ret >= 0)
+		d350t1013v1_esd_schedule(d350t1013v1);
+}
+
+/* Accounts the prepare() latency and that of enable(), started at start. */
+static void d350t1013v1_account_transition(struct d350t1013v1 *d350t1013v1,
+					   enum d350t1013v1_transition transition,
+					   ktime_t start)
+{
+	s64 enable_us = ktime_us_delta(ktime_get(), start);
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	d350t1013v1_stats_add(&d350t1013v1->prepare_stats[transition],
+			      d350t1013v1->prepare_us);
+	d350t1013v1_stats_add(&d350t1013v1->enable_stats[transition], enable_us);
+	mutex_unlock(&d350t1013v1->stats_lock);
+}
+
+static int d350t1013v1_enable(struct drm_panel *panel)
+{
+	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	ktime_t start = ktime_get();
+	int ret;
+
+	if (d350t1013v1->seamless) {
+		mutex_lock(&d350t1013v1->lock);
+		d350t1013v1->seamless = false;
+		ret = d350t1013v1->init_ret;
+		if (ret == 0 && !d350t1013v1->enabled)
+			ret = -ENODEV;
+		if (ret == 0) {
+			d350t1013v1_update_mode(d350t1013v1);
+			d350t1013v1_esd_schedule(d350t1013v1);
+			d350t1013v1_account_transition(d350t1013v1,
+						       D350T1013V1_TRANSITION_SEAMLESS,
+						       start);
+		}
+		mutex_unlock(&d350t1013v1->lock);
+		return ret;
+	}
+
+	wait_for_completion(&d350t1013v1->init_done);
+
+	mutex_lock(&d350t1013v1->lock);
+
+	ret = d350t1013v1->init_ret;
+	if (ret < 0)
+		goto out_unlock;
+
+	ret = d350t1013v1_display_on(d350t1013v1);
+	if (ret < 0)
+		goto out_unlock;
+
+	d350t1013v1->enabled = true;
+	d350t1013v1_update_mode(d350t1013v1);
+	d350t1013v1_esd_schedule(d350t1013v1);
+	d350t1013v1_update_state(d350t1013v1);
+	d350t1013v1_account_transition(d350t1013v1, d350t1013v1->transition, start);
+
+out_unlock:
+	mutex_unlock(&d350t1013v1->lock);
+	return ret;
+}
+
+static int d350t1013v1_disable(struct drm_panel *panel)
+{
+	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	int ret = 0;
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->seamless = d350t1013v1_is_seamless(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	cancel_delayed_work_sync(&d350t1013v1->esd_work);
+
+	if (d350t1013v1->seamless) {
+		dev_dbg(&d350t1013v1->dsi->dev, "seamless mode switch\n");
+		return 0;
+	}
+
+	/* A failed bring-up or recovery may have left the panel off. */
+	mutex_lock(&d350t1013v1->lock);
+	if (d350t1013v1->enabled) {
+		d350t1013v1->enabled = false;
+		d350t1013v1_update_state(d350t1013v1);
+		ret = mipi_dsi_dcs_set_display_off(d350t1013v1->dsi);
+	}
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret;
+}
+
+static int d350t1013v1_blank(struct d350t1013v1 *d350t1013v1)
+{
+	int ret;
+
+	d350t1013v1_wait_ready(d350t1013v1);
+	ret = mipi_dsi_dcs_enter_sleep_mode(d350t1013v1->dsi);
+	if (ret < 0) {
+		d350t1013v1_power_off(d350t1013v1);
+		return ret;
+	}
+	d350t1013v1_settle(d350t1013v1, d350t1013v1->timings.sleep_in_ms);
+
+	/*
+	 * In fast blank mode supplies and register state are kept alive
+	 * until the runtime PM autosuspend delay expires. Otherwise the panel
+	 * is powered off as soon as the sleep-in time has passed. Either way
+	 * unprepare() doesn't wait, and a prepare() in the meantime only has
+	 * to wake the panel up.
+	 */
+	if (!fast_blank)
+		queue_delayed_work(system_wq, &d350t1013v1->off_work,
+				   msecs_to_jiffies(d350t1013v1->timings.sleep_in_ms));
+
+	return 0;
+}
+
+static void d350t1013v1_off_work(struct work_struct *work)
+{
+	struct d350t1013v1 *d350t1013v1 =
+		container_of(to_delayed_work(work), struct d350t1013v1, off_work);
+
+	mutex_lock(&d350t1013v1->lock);
+	if (!d350t1013v1->prepared && d350t1013v1->powered)
+		d350t1013v1_power_off(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+}
+
+static int d350t1013v1_unprepare(struct drm_panel *panel)
+{
+	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	struct device *dev = &d350t1013v1->dsi->dev;
+	int ret = 0;
+
+	if (!d350t1013v1->prepared || d350t1013v1->seamless)
+		return 0;
+
+	/* An asynchronous bring-up may still be running. */
+	flush_work(&d350t1013v1->init_work);
+
+	mutex_lock(&d350t1013v1->lock);
+	if (d350t1013v1->init_ret == 0)
+		ret = d350t1013v1_blank(d350t1013v1);
+
+	d350t1013v1->init_ret = -ENODEV;
+	d350t1013v1->prepared = false;
+	d350t1013v1_update_state(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	pm_runtime_mark_last_busy(dev);
+	pm_runtime_put_autosuspend(dev);
+
+	return ret;
+}
+
+/* The ST7701S receiver supports up to 2 lanes at 500 Mbit/s each. */
+#define D350T1013V1_MAX_LANES		2
+#define D350T1013V1_MAX_HS_RATE		500000000
+
+/* Checks that the configured DSI link can carry the mode. */
+static bool d350t1013v1_mode_fits(struct mipi_dsi_device *dsi,
+				  const struct drm_display_mode *mode)
+{
+	u64 rate = div_u64((u64)mode->clock * 1000 *
+			   mipi_dsi_pixel_format_to_bpp(dsi->format), dsi->lanes);
+
+	return rate <= (dsi->hs_rate ?: D350T1013V1_MAX_HS_RATE);
+}
+
+static int d350t1013v1_get_modes(struct drm_panel *panel,
+			    struct drm_connector *connector)
+{
+	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	const struct d350t1013v1_panel_desc *desc = d350t1013v1->desc;
+	const struct drm_display_mode *desc_mode;
+	struct drm_display_mode *mode;
+	unsigned int i, count = 0;
+
+	d350t1013v1->connector = connector;
+
+	for (i = 0; i < desc->num_modes; i++) {
+		desc_mode = &desc->modes[i];
+
+		/* Probe made sure that at least the preferred mode fits. */
+		if (!d350t1013v1_mode_fits(d350t1013v1->dsi, desc_mode)) {
+			dev_dbg(&d350t1013v1->dsi->dev,
+				"mode %ux%u@%u doesn't fit into the DSI link\n",
+				desc_mode->hdisplay, desc_mode->vdisplay,
+				drm_mode_vrefresh(desc_mode));
+			continue;
+		}
+
+		mode = drm_mode_duplicate(connector->dev, desc_mode);
+		if (!mode) {
+			dev_err(&d350t1013v1->dsi->dev, "failed to add mode %ux%u@%u\n",
+				desc_mode->hdisplay, desc_mode->vdisplay,
+				drm_mode_vrefresh(desc_mode));
+			return -ENOMEM;
+		}
+
+		drm_mode_set_name(mode);
+		drm_mode_probed_add(connector, mode);
+		count++;
+	}
+
+	connector->display_info.width_mm = desc->modes[0].width_mm;
+	connector->display_info.height_mm = desc->modes[0].height_mm;
+	connector->display_info.bpc = d350t1013v1->bpc;
+	drm_display_info_set_bus_formats(&connector->display_info,
+					 &d350t1013v1->bus_format, 1);
+
+	return count;
+}
+
+static const char * const d350t1013v1_ambient_names[] = {
+	[0] = "off",
+	[D350T1013V1_AMBIENT_IDLE] = "idle",
+	[D350T1013V1_AMBIENT_PARTIAL] = "partial",
+	[D350T1013V1_AMBIENT_IDLE | D350T1013V1_AMBIENT_PARTIAL] = "idle-partial",
+};
+
+static ssize_t ambient_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%s\n",
+			  d350t1013v1_ambient_names[d350t1013v1->ambient]);
+}
+
+static ssize_t ambient_store(struct device *dev, struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+	int ambient, ret = 0;
+
+	ambient = sysfs_match_string(d350t1013v1_ambient_names, buf);
+	if (ambient < 0)
+		return ambient;
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->ambient = ambient;
+	if (d350t1013v1->enabled)
+		ret = d350t1013v1_apply_ambient(d350t1013v1);
+	d350t1013v1_update_state(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(ambient);
+
+static ssize_t ambient_rows_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u %u\n", d350t1013v1->partial_start,
+			  d350t1013v1->partial_end);
+}
+
+static ssize_t ambient_rows_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+	unsigned int start, end;
+	int ret = 0;
+
+	if (sscanf(buf, "%u %u", &start, &end) != 2)
+		return -EINVAL;
+	if (start > end || end >= d350t1013v1->desc->modes[0].vdisplay)
+		return -ERANGE;
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->partial_start = start;
+	d350t1013v1->partial_end = end;
+	if (d350t1013v1->enabled &&
+	    (d350t1013v1->ambient & D350T1013V1_AMBIENT_PARTIAL))
+		ret = d350t1013v1_apply_ambient(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(ambient_rows);
+
+/* Values of WRCACE, the DCS power save register. */
+static const char * const d350t1013v1_cabc_names[] = {
+	"off",
+	"ui",
+	"still",
+	"moving",
+};
+
+static ssize_t cabc_mode_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%s\n",
+			  d350t1013v1_cabc_names[d350t1013v1->cabc_mode]);
+}
+
+static ssize_t cabc_mode_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+	int mode, ret = 0;
+
+	mode = sysfs_match_string(d350t1013v1_cabc_names, buf);
+	if (mode < 0)
+		return mode;
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->cabc_mode = mode;
+	if (d350t1013v1->enabled)
+		ret = d350t1013v1_apply_backlight(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(cabc_mode);
+
+/* Lists the profiles, the selected one in brackets. */
+static ssize_t profile_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+	const char *name;
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < d350t1013v1->num_profiles; i++) {
+		name = d350t1013v1->profiles[i].name;
+		if (i == d350t1013v1->profile)
+			len += sysfs_emit_at(buf, len, "[%s] ", name);
+		else
+			len += sysfs_emit_at(buf, len, "%s ", name);
+	}
+	buf[len - 1] = '\n';
+
+	return len;
+}
+
+static ssize_t profile_store(struct device *dev, struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < d350t1013v1->num_profiles; i++)
+		if (sysfs_streq(buf, d350t1013v1->profiles[i].name))
+			break;
+	if (i == d350t1013v1->num_profiles)
+		return -EINVAL;
+
+	/* Only the profile banks are reprogrammed while the display runs. */
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1->profile = i;
+	if (d350t1013v1->enabled)
+		ret = d350t1013v1_apply_profile(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(profile);
+
+static struct attribute *d350t1013v1_attrs[] = {
+	&dev_attr_ambient.attr,
+	&dev_attr_ambient_rows.attr,
+	&dev_attr_profile.attr,
+	&dev_attr_cabc_mode.attr,
+	NULL
+};
+
+static umode_t d350t1013v1_attr_is_visible(struct kobject *kobj,
+					   struct attribute *attr, int n)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(kobj_to_dev(kobj));
+
+	if (attr == &dev_attr_cabc_mode.attr && !d350t1013v1->dcs_backlight)
+		return 0;
+
+	return attr->mode;
+}
+
+static const struct attribute_group d350t1013v1_group = {
+	.attrs = d350t1013v1_attrs,
+	.is_visible = d350t1013v1_attr_is_visible,
+};
+__ATTRIBUTE_GROUPS(d350t1013v1);
+
+static int d350t1013v1_runtime_suspend(struct device *dev)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+
+	/* A panel kept initialized by fast blank is already in sleep mode. */
+	mutex_lock(&d350t1013v1->lock);
+	if (d350t1013v1->powered)
+		d350t1013v1_power_off(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	return 0;
+}
+
+static int d350t1013v1_runtime_resume(struct device *dev)
+{
+	/* Powering up is left to prepare(), which knows the panel state. */
+	return 0;
+}
+
+static int d350t1013v1_suspend(struct device *dev)
+{
+	struct d350t1013v1 *d350t1013v1 = dev_get_drvdata(dev);
+
+	flush_work(&d350t1013v1->init_work);
+	flush_work(&d350t1013v1->early_work);
+	cancel_delayed_work_sync(&d350t1013v1->off_work);
+	/* The health check only runs while enabled, enable() restarts it. */
+	cancel_delayed_work_sync(&d350t1013v1->esd_work);
+
+	/*
+	 * DRM normally unprepares the panel before system sleep. If it
+	 * didn't, the panel loses its supply below anyway. Mark the bring-up
+	 * as failed, so that disable() and unprepare() leave the unpowered
+	 * panel alone and the next prepare() does a cold init.
+	 */
+	if (d350t1013v1->prepared) {
+		dev_warn(dev, "suspending while prepared\n");
+		mutex_lock(&d350t1013v1->lock);
+		d350t1013v1->enabled = false;
+		d350t1013v1->init_ret = -ENODEV;
+		d350t1013v1_update_state(d350t1013v1);
+		mutex_unlock(&d350t1013v1->lock);
+	}
+
+	return pm_runtime_force_suspend(dev);
+}
+
+static int d350t1013v1_resume(struct device *dev)
+{
+	return pm_runtime_force_resume(dev);
+}
+
+static const struct dev_pm_ops d350t1013v1_pm_ops = {
+	SYSTEM_SLEEP_PM_OPS(d350t1013v1_suspend, d350t1013v1_resume)
+	RUNTIME_PM_OPS(d350t1013v1_runtime_suspend, d350t1013v1_runtime_resume, NULL)
+};
+
+static const struct drm_panel_funcs d350t1013v1_funcs = {
+	.disable	= d350t1013v1_disable,
+	.unprepare	= d350t1013v1_unprepare,
+	.prepare	= d350t1013v1_prepare,
+	.enable		= d350t1013v1_enable,
+	.get_modes	= d350t1013v1_get_modes,
+};
+
+/* All modes share the qualified porches and only differ in pixel clock. */
+#define D350T1013V1_MODE(_clock, _type) \
+	{ \
+		.clock			= _clock, \
+\
+		.hdisplay		= 480, \
+		.hsync_start	= 480 + 50, \
+		.hsync_end		= 480 + 50 + 16, \
+		.htotal			= 480 + 50 + 16 + 2, \
+\
+		.vdisplay		= 800, \
+		.vsync_start	= 800 + 16, \
+		.vsync_end		= 800 + 16 + 14, \
+		.vtotal			= 800 + 16 + 14 + 2, \
+\
+		.width_mm		= 45, \
+		.height_mm		= 76, \
+\
+		.type = DRM_MODE_TYPE_DRIVER | (_type), \
+	}
+
+static const struct drm_display_mode d350t1013v1_modes[] = {
+	/* 55 Hz, the timing the panel was qualified with. */
+	D350T1013V1_MODE(25000, DRM_MODE_TYPE_PREFERRED),
+	/* 60 Hz. */
+	D350T1013V1_MODE(27360, 0),
+	/* 30 Hz, low power for static content. */
+	D350T1013V1_MODE(13680, 0),
+};
+
+static const struct d350t1013v1_timings d350t1013v1_timings = {
+	.supply_ramp_ms		= 20,
+	.reset_ms			= 5,
+	.soft_reset_ms		= 5,
+	.sleep_out_ms		= 120,
+	.power_setup_ms		= 100,
+	.analog_setup_ms	= 10,
+	.colmod_ms			= 0,
+	.sleep_in_ms		= 120,
+};
+
+/* Init sequence provided by manufacturer. */
+static const struct d350t1013v1_cmd d350t1013v1_init_cmds[] = {
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x13),
+	D350T1013V1_CMD(0xEF, 0x08),
+
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x10),
+	D350T1013V1_CMD(0xC0, 0x63, 0x00),
+	D350T1013V1_CMD(0xC1, 0x10, 0x02),
+	D350T1013V1_CMD(0xC2, 0x31, 0x02),
+	D350T1013V1_CMD(0xCC, 0x10),
+	D350T1013V1_CMD(0xB0, 0xC0, 0x0C, 0x92, 0x0C, 0x10, 0x05, 0x02, 0x0D,
+		0x07, 0x21, 0x04, 0x53, 0x11, 0x6A, 0x32, 0x1F),
+	D350T1013V1_CMD(0xB1, 0xC0, 0x87, 0xCF, 0x0C, 0x10, 0x06, 0x00, 0x03,
+		0x08, 0x1D, 0x06, 0x54, 0x12, 0xE6, 0xEC, 0x0F),
+
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x11),
+	D350T1013V1_CMD(0xB0, 0x5D),
+	D350T1013V1_CMD(0xB1, 0x62),
+	D350T1013V1_CMD(0xB2, 0x82),
+	D350T1013V1_CMD(0xB3, 0x80),
+	D350T1013V1_CMD(0xB5, 0x42),
+	D350T1013V1_CMD(0xB7, 0x85),
+	D350T1013V1_CMD(0xB8, 0x20),
+	D350T1013V1_CMD(0xC0, 0x09),
+	D350T1013V1_CMD(0xC1, 0x78),
+	D350T1013V1_CMD(0xC2, 0x78),
+	D350T1013V1_CMD(0xD0, 0x88),
+	D350T1013V1_CMD_DELAY(D350T1013V1_DELAY_POWER_SETUP, 0xEE, 0x42),
+
+	D350T1013V1_CMD(0xE0, 0x00, 0x00, 0x02),
+	D350T1013V1_CMD(0xE1, 0x04, 0xA0, 0x06, 0xA0, 0x05, 0xA0, 0x07, 0xA0,
+		0x00, 0x44, 0x44),
+	D350T1013V1_CMD(0xE2, 0x00, 0x00, 0x33, 0x33, 0x01, 0xA0, 0x00, 0x00,
+		0x01, 0xA0, 0x00, 0x00),
+	D350T1013V1_CMD(0xE3, 0x00, 0x00, 0x33, 0x33),
+	D350T1013V1_CMD(0xE4, 0x44, 0x44),
+	D350T1013V1_CMD(0xE5, 0x0C, 0x30, 0xA0, 0xA0, 0x0E, 0x32, 0xA0, 0xA0,
+		0x08, 0x2C, 0xA0, 0xA0, 0x0A, 0x2E, 0xA0, 0xA0),
+	D350T1013V1_CMD(0xE6, 0x00, 0x00, 0x33, 0x33),
+	D350T1013V1_CMD(0xE7, 0x44, 0x44),
+	D350T1013V1_CMD(0xE8, 0x0D, 0x31, 0xA0, 0xA0, 0x0F, 0x33, 0xA0, 0xA0,
+		0x09, 0x2D, 0xA0, 0xA0, 0x0B, 0x2F, 0xA0, 0xA0),
+	D350T1013V1_CMD(0xEB, 0x00, 0x01, 0xE4, 0xE4, 0x44, 0x88, 0x00),
+	D350T1013V1_CMD(0xED, 0xFF, 0xF5, 0x47, 0x6F, 0x0B, 0xA1, 0xA2, 0xBF,
+		0xFB, 0x2A, 0x1A, 0xB0, 0xF6, 0x74, 0x5F, 0xFF),
+	D350T1013V1_CMD(0xEF, 0x08, 0x08, 0x08, 0x40, 0x3F, 0x64),
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x13),
+	D350T1013V1_CMD_DELAY(D350T1013V1_DELAY_ANALOG_SETUP, 0xE8, 0x00, 0x0E),
+
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x00),
+	D350T1013V1_CMD_DELAY(D350T1013V1_DELAY_SLEEP_OUT, 0x11),
+
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x13),
+	D350T1013V1_CMD_DELAY(D350T1013V1_DELAY_ANALOG_SETUP, 0xE8, 0x00, 0x0C),
+
+	D350T1013V1_CMD(0xE8, 0x00, 0x00),
+	D350T1013V1_CMD(0xFF, 0x77, 0x01, 0x00, 0x00, 0x00),
+};
+
+static const char * const d350t1013v1_supply_names[] = {
+	"vcc",
+};
+
+static const struct d350t1013v1_panel_desc d350t1013v1_desc = {
+	.modes = d350t1013v1_modes,
+	.num_modes = ARRAY_SIZE(d350t1013v1_modes),
+	.timings = &d350t1013v1_timings,
+	.init_cmds = d350t1013v1_init_cmds,
+	.num_init_cmds = ARRAY_SIZE(d350t1013v1_init_cmds),
+	.firmware_name = "dxwy-d350t1013v1-init.bin",
+	.lanes = 2,
+	/*
+	 * The ST7701S has no frame memory, so it can only be driven in
+	 * video mode.
+	 */
+	.flags = MIPI_DSI_MODE_VIDEO |  MIPI_DSI_CLOCK_NON_CONTINUOUS |
+			MIPI_DSI_MODE_LPM,
+	.format = MIPI_DSI_FMT_RGB888,
+	.supply_names = d350t1013v1_supply_names,
+	.num_supplies = ARRAY_SIZE(d350t1013v1_supply_names),
+};
+
+static int d350t1013v1_phase_stats_show(struct seq_file *m, void *data)
+{
+	struct d350t1013v1 *d350t1013v1 = m->private;
+	const struct d350t1013v1_phase_stats *stats;
+	int i;
+
+	seq_printf(m, "%-12s %8s %10s %10s %10s\n",
+		   "phase", "count", "min_us", "avg_us", "max_us");
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	for (i = 0; i < D350T1013V1_NUM_PHASES; i++) {
+		stats = &d350t1013v1->phase_stats[i];
+		if (!stats->count)
+			continue;
+
+		seq_printf(m, "%-12s %8u %10lld %10lld %10lld\n",
+			   d350t1013v1_phase_names[i], stats->count,
+			   stats->min_us,
+			   div_s64(stats->total_us, stats->count),
+			   stats->max_us);
+	}
+	mutex_unlock(&d350t1013v1->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(d350t1013v1_phase_stats);
+
+static int d350t1013v1_cmd_failures_show(struct seq_file *m, void *data)
+{
+	struct d350t1013v1 *d350t1013v1 = m->private;
+	const struct d350t1013v1_cmd *cmds = d350t1013v1->init_cmds;
+	u8 bank = D350T1013V1_BANK_NONE;
+	unsigned int i;
+
+	seq_printf(m, "%5s %4s %6s %8s\n", "index", "bank", "opcode", "failures");
+
+	mutex_lock(&d350t1013v1->lock);
+	for (i = 0; i < d350t1013v1->num_init_cmds; i++) {
+		if (d350t1013v1_is_bksel(&cmds[i]))
+			bank = cmds[i].data[D350T1013V1_BKSEL_LEN - 1];
+		if (!d350t1013v1->cmd_failures[i])
+			continue;
+
+		seq_printf(m, "%5u %4.2x %6.2x %8u\n", i, bank,
+			   cmds[i].data[0], d350t1013v1->cmd_failures[i]);
+	}
+	mutex_unlock(&d350t1013v1->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(d350t1013v1_cmd_failures);
+
+static void d350t1013v1_show_latency(struct seq_file *m, const char *callback,
+				     const struct d350t1013v1_phase_stats *stats)
+{
+	int i;
+
+	for (i = 0; i < D350T1013V1_NUM_TRANSITIONS; i++) {
+		if (!stats[i].count)
+			continue;
+
+		seq_printf(m, "%-10s %-10s %8u %10lld %10lld %10lld\n", callback,
+			   d350t1013v1_transition_names[i], stats[i].count,
+			   stats[i].min_us,
+			   div_s64(stats[i].total_us, stats[i].count),
+			   stats[i].max_us);
+	}
+}
+
+static int d350t1013v1_power_stats_show(struct seq_file *m, void *data)
+{
+	struct d350t1013v1 *d350t1013v1 = m->private;
+	s64 residency_us;
+	int i;
+
+	seq_printf(m, "%-10s %8s %14s\n", "state", "entries", "residency_ms");
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	for (i = 0; i < D350T1013V1_NUM_STATES; i++) {
+		residency_us = d350t1013v1->state_us[i];
+		if (i == d350t1013v1->state)
+			residency_us += ktime_us_delta(ktime_get(),
+						       d350t1013v1->state_since);
+
+		seq_printf(m, "%-10s %8u %14lld%s\n", d350t1013v1_state_names[i],
+			   d350t1013v1->state_entries[i],
+			   div_s64(residency_us, USEC_PER_MSEC),
+			   i == d350t1013v1->state ? " *" : "");
+	}
+
+	seq_printf(m, "\n%-10s %-10s %8s %10s %10s %10s\n", "callback",
+		   "transition", "count", "min_us", "avg_us", "max_us");
+	d350t1013v1_show_latency(m, "prepare", d350t1013v1->prepare_stats);
+	d350t1013v1_show_latency(m, "enable", d350t1013v1->enable_stats);
+	mutex_unlock(&d350t1013v1->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(d350t1013v1_power_stats);
+
+static unsigned int d350t1013v1_total_failures(struct d350t1013v1 *d350t1013v1)
+{
+	unsigned int i, failures = 0;
+
+	for (i = 0; i < d350t1013v1->num_init_cmds; i++)
+		failures += d350t1013v1->cmd_failures[i];
+
+	return failures;
+}
+
+static void d350t1013v1_bench_add(struct d350t1013v1 *d350t1013v1,
+				  enum d350t1013v1_bench_stage stage,
+				  ktime_t start)
+{
+	struct d350t1013v1_bench *bench = &d350t1013v1->bench;
+	s64 duration_us = ktime_us_delta(ktime_get(), start);
+	unsigned int bucket = 0;
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	d350t1013v1_stats_add(&bench->stages[stage], duration_us);
+	if (stage == D350T1013V1_BENCH_CYCLE) {
+		if (duration_us >= USEC_PER_MSEC)
+			bucket = min_t(unsigned int,
+				       ilog2(div_s64(duration_us, USEC_PER_MSEC)) + 1,
+				       D350T1013V1_BENCH_BUCKETS - 1);
+		bench->histogram[bucket]++;
+	}
+	mutex_unlock(&d350t1013v1->stats_lock);
+}
+
+/* Runs one benchmark cycle on an enabled panel. Called with lock held. */
+static int d350t1013v1_bench_cycle(struct d350t1013v1 *d350t1013v1)
+{
+	ktime_t cycle_start = ktime_get(), start;
+	int ret;
+
+	ret = mipi_dsi_dcs_set_display_off(d350t1013v1->dsi);
+	if (ret == 0)
+		ret = d350t1013v1_blank(d350t1013v1);
+	if (ret < 0)
+		return ret;
+	/*
+	 * Run the deferred power off right away, so that the cycle measures
+	 * the bring-up after the sleep-in time has passed.
+	 */
+	if (cancel_delayed_work(&d350t1013v1->off_work))
+		d350t1013v1_power_off(d350t1013v1);
+	d350t1013v1_bench_add(d350t1013v1, D350T1013V1_BENCH_UNPREPARE,
+			      cycle_start);
+
+	start = ktime_get();
+	ret = d350t1013v1_power_on(d350t1013v1);
+	if (ret < 0)
+		return ret;
+	d350t1013v1_bench_add(d350t1013v1, D350T1013V1_BENCH_PREPARE, start);
+
+	start = ktime_get();
+	ret = d350t1013v1_display_on(d350t1013v1);
+	if (ret < 0)
+		return ret;
+	d350t1013v1_bench_add(d350t1013v1, D350T1013V1_BENCH_ENABLE, start);
+
+	d350t1013v1_bench_add(d350t1013v1, D350T1013V1_BENCH_CYCLE, cycle_start);
 
-#include <video/mipi_display.h>
+	return 0;
+}
 
-struct d350t1013v1_panel_desc {
-	const struct drm_display_mode *mode;
-	unsigned int lanes;
-	unsigned long flags;
-	enum mipi_dsi_pixel_format format;
-	const char *const *supply_names;
-	unsigned int num_supplies;
-};
+/*
+ * Replays the blank and bring-up of an enabled panel for the given number
+ * of cycles, using the same paths as unprepare(), prepare() and enable()
+ * with the current module parameters. The DSI host and the rest of the
+ * display pipeline are left running, so only the panel side is measured.
+ *
+ * The lock is only held for one cycle at a time, so that DRM commits and
+ * sysfs writes are delayed by at most a cycle. The benchmark stops once
+ * the panel is disabled.
+ */
+static int d350t1013v1_benchmark(struct d350t1013v1 *d350t1013v1,
+				 unsigned int cycles)
+{
+	struct d350t1013v1_bench *bench = &d350t1013v1->bench;
+	unsigned int i, failures;
+	int ret = 0;
 
-struct d350t1013v1 {
-	struct drm_panel panel;
-	struct mipi_dsi_device *dsi;
-	const struct d350t1013v1_panel_desc *desc;
-	struct regulator_bulk_data *supplies;
-	struct gpio_desc *reset;
+	cancel_delayed_work_sync(&d350t1013v1->esd_work);
+
+	mutex_lock(&d350t1013v1->lock);
+	if (!d350t1013v1->enabled || d350t1013v1->seamless ||
+	    d350t1013v1->bench_running) {
+		ret = d350t1013v1->bench_running ? -EBUSY : -ENODEV;
+		mutex_unlock(&d350t1013v1->lock);
+		return ret;
+	}
+	d350t1013v1->bench_running = true;
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	memset(bench, 0, sizeof(*bench));
+	bench->requested = cycles;
+	mutex_unlock(&d350t1013v1->stats_lock);
+
+	failures = d350t1013v1_total_failures(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	for (i = 0; i < cycles; i++) {
+		if (signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+
+		mutex_lock(&d350t1013v1->lock);
+		if (!d350t1013v1->enabled || d350t1013v1->seamless) {
+			mutex_unlock(&d350t1013v1->lock);
+			ret = -ENODEV;
+			break;
+		}
+
+		ret = d350t1013v1_bench_cycle(d350t1013v1);
+		if (ret < 0) {
+			/* Leave the panel off, the next modeset brings it up again. */
+			dev_err(&d350t1013v1->dsi->dev,
+				"benchmark failed in cycle %u: %d\n", i, ret);
+			d350t1013v1_power_off(d350t1013v1);
+			d350t1013v1->enabled = false;
+			d350t1013v1->init_ret = ret;
+			d350t1013v1_update_state(d350t1013v1);
+		}
+		mutex_unlock(&d350t1013v1->lock);
+		if (ret < 0)
+			break;
+	}
+
+	mutex_lock(&d350t1013v1->lock);
+	mutex_lock(&d350t1013v1->stats_lock);
+	bench->dsi_errors = d350t1013v1_total_failures(d350t1013v1) - failures +
+			    (ret < 0 && ret != -EINTR && ret != -ENODEV);
+	bench->ret = ret;
+	mutex_unlock(&d350t1013v1->stats_lock);
+
+	d350t1013v1->bench_running = false;
+	if (d350t1013v1->enabled && !d350t1013v1->seamless)
+		d350t1013v1_esd_schedule(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret;
+}
+
+static int d350t1013v1_benchmark_show(struct seq_file *m, void *data)
+{
+	struct d350t1013v1 *d350t1013v1 = m->private;
+	const struct d350t1013v1_bench *bench = &d350t1013v1->bench;
+	const struct d350t1013v1_phase_stats *stats;
+	int i;
+
+	mutex_lock(&d350t1013v1->stats_lock);
+	seq_printf(m, "cycles: %u/%u\n",
+		   bench->stages[D350T1013V1_BENCH_CYCLE].count, bench->requested);
+	seq_printf(m, "dsi_errors: %u\n", bench->dsi_errors);
+	seq_printf(m, "result: %d\n\n", bench->ret);
+
+	seq_printf(m, "%-12s %8s %10s %10s %10s\n",
+		   "stage", "count", "min_us", "avg_us", "max_us");
+	for (i = 0; i < D350T1013V1_NUM_BENCH_STAGES; i++) {
+		stats = &bench->stages[i];
+		if (!stats->count)
+			continue;
+
+		seq_printf(m, "%-12s %8u %10lld %10lld %10lld\n",
+			   d350t1013v1_bench_stage_names[i], stats->count,
+			   stats->min_us,
+			   div_s64(stats->total_us, stats->count),
+			   stats->max_us);
+	}
+
+	seq_printf(m, "\n%-12s %8s\n", "cycle_ms", "count");
+	for (i = 0; i < D350T1013V1_BENCH_BUCKETS; i++) {
+		if (!bench->histogram[i])
+			continue;
+
+		if (i == D350T1013V1_BENCH_BUCKETS - 1)
+			seq_printf(m, ">=%-10u %8u\n", 1U << (i - 1),
+				   bench->histogram[i]);
+		else
+			seq_printf(m, "<%-11u %8u\n", 1U << i, bench->histogram[i]);
+	}
+	mutex_unlock(&d350t1013v1->stats_lock);
+
+	return 0;
+}
+
+static int d350t1013v1_benchmark_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, d350t1013v1_benchmark_show, inode->i_private);
+}
+
+/* Writing a cycle count runs the benchmark, reading reports its results. */
+static ssize_t d350t1013v1_benchmark_write(struct file *file,
+					   const char __user *buf,
+					   size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	unsigned int cycles;
+	int ret;
+
+	ret = kstrtouint_from_user(buf, count, 0, &cycles);
+	if (ret)
+		return ret;
+
+	if (!cycles || cycles > D350T1013V1_BENCH_MAX_CYCLES)
+		return -EINVAL;
+
+	ret = d350t1013v1_benchmark(m->private, cycles);
+
+	return ret < 0 ? ret : count;
+}
+
+static const struct file_operations d350t1013v1_benchmark_fops = {
+	.owner = THIS_MODULE,
+	.open = d350t1013v1_benchmark_open,
+	.read = seq_read,
+	.write = d350t1013v1_benchmark_write,
+	.llseek = seq_lseek,
+	.release = single_release,
 };
 
-static inline struct d350t1013v1 *panel_to_d350t1013v1(struct drm_panel *panel)
+static void d350t1013v1_debugfs_init(struct d350t1013v1 *d350t1013v1)
 {
-	return container_of(panel, struct d350t1013v1, panel);
+	struct device *dev = &d350t1013v1->dsi->dev;
+	char name[64];
+
+	snprintf(name, sizeof(name), "d350t1013v1-%s", dev_name(dev));
+	d350t1013v1->debugfs = debugfs_create_dir(name, NULL);
+
+	debugfs_create_file("phase_stats", 0444, d350t1013v1->debugfs,
+			    d350t1013v1, &d350t1013v1_phase_stats_fops);
+	debugfs_create_file("cmd_failures", 0444, d350t1013v1->debugfs,
+			    d350t1013v1, &d350t1013v1_cmd_failures_fops);
+	debugfs_create_file("power_stats", 0444, d350t1013v1->debugfs,
+			    d350t1013v1, &d350t1013v1_power_stats_fops);
+	debugfs_create_file("benchmark", 0600, d350t1013v1->debugfs,
+			    d350t1013v1, &d350t1013v1_benchmark_fops);
+	debugfs_create_u32("esd_checks", 0444, d350t1013v1->debugfs,
+			   &d350t1013v1->esd_checks);
+	debugfs_create_u32("esd_recoveries", 0444, d350t1013v1->debugfs,
+			   &d350t1013v1->esd_recoveries);
 }
 
-static inline int d350t1013v1_dsi_write(struct d350t1013v1 *d350t1013v1, const void *seq,
-				   size_t len)
+static int d350t1013v1_bl_update_status(struct backlight_device *bl)
 {
-	return mipi_dsi_dcs_write_buffer(d350t1013v1->dsi, seq, len);
+	struct d350t1013v1 *d350t1013v1 = bl_get_data(bl);
+	int ret = 0;
+
+	mutex_lock(&d350t1013v1->lock);
+	if (d350t1013v1->enabled)
+		ret = mipi_dsi_dcs_set_display_brightness(d350t1013v1->dsi,
+							  backlight_get_brightness(bl));
+	mutex_unlock(&d350t1013v1->lock);
+
+	return ret;
 }
 
-#define D350T1013V1_DSI(d350t1013v1, seq...) \
-	{ \
-		const u8 d[] = { seq };	\
-		d350t1013v1_dsi_write(d350t1013v1, d, ARRAY_SIZE(d)); \
-	}
-
-static void d350t1013v1_init_sequence(struct d350t1013v1 *d350t1013v1)
-{
-	/* Init sequence provided by manufacturer. */
-
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x13);
-	D350T1013V1_DSI(d350t1013v1, 0xEF, 0x08);
-
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x10);
-	D350T1013V1_DSI(d350t1013v1, 0xC0, 0x63, 0x00);
-	D350T1013V1_DSI(d350t1013v1, 0xC1, 0x10, 0x02);
-	D350T1013V1_DSI(d350t1013v1, 0xC2, 0x31, 0x02);
-	D350T1013V1_DSI(d350t1013v1, 0xCC, 0x10);
-	D350T1013V1_DSI(d350t1013v1, 0xB0, 0xC0, 0x0C, 0x92, 0x0C, 0x10, 0x05,
-		0x02, 0x0D, 0x07, 0x21, 0x04, 0x53, 0x11, 0x6A, 0x32, 0x1F);
-	D350T1013V1_DSI(d350t1013v1, 0xB1, 0xC0, 0x87, 0xCF, 0x0C, 0x10, 0x06,
-		0x00, 0x03, 0x08, 0x1D, 0x06, 0x54, 0x12, 0xE6, 0xEC, 0x0F);
-
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x11);
-	D350T1013V1_DSI(d350t1013v1, 0xB0, 0x5D);
-	D350T1013V1_DSI(d350t1013v1, 0xB1, 0x62);
-	D350T1013V1_DSI(d350t1013v1, 0xB2, 0x82);
-	D350T1013V1_DSI(d350t1013v1, 0xB3, 0x80);
-	D350T1013V1_DSI(d350t1013v1, 0xB5, 0x42);
-	D350T1013V1_DSI(d350t1013v1, 0xB7, 0x85);
-	D350T1013V1_DSI(d350t1013v1, 0xB8, 0x20);
-	D350T1013V1_DSI(d350t1013v1, 0xC0, 0x09);
-	D350T1013V1_DSI(d350t1013v1, 0xC1, 0x78);
-	D350T1013V1_DSI(d350t1013v1, 0xC2, 0x78);
-	D350T1013V1_DSI(d350t1013v1, 0xD0, 0x88);
-	D350T1013V1_DSI(d350t1013v1, 0xEE, 0x42);
-	msleep(200);
-
-	D350T1013V1_DSI(d350t1013v1, 0xE0, 0x00, 0x00, 0x02);
-	D350T1013V1_DSI(d350t1013v1, 0xE1, 0x04, 0xA0, 0x06, 0xA0, 0x05, 0xA0,
-		0x07, 0xA0, 0x00, 0x44, 0x44);
-	D350T1013V1_DSI(d350t1013v1, 0xE2, 0x00, 0x00, 0x33, 0x33, 0x01, 0xA0,
-		0x00, 0x00, 0x01, 0xA0, 0x00, 0x00);
-	D350T1013V1_DSI(d350t1013v1, 0xE3, 0x00, 0x00, 0x33, 0x33);
-	D350T1013V1_DSI(d350t1013v1, 0xE4, 0x44, 0x44);
-	D350T1013V1_DSI(d350t1013v1, 0xE5, 0x0C, 0x30, 0xA0, 0xA0, 0x0E, 0x32,
-		0xA0, 0xA0, 0x08, 0x2C, 0xA0, 0xA0, 0x0A, 0x2E, 0xA0, 0xA0);
-	D350T1013V1_DSI(d350t1013v1, 0xE6, 0x00, 0x00, 0x33, 0x33);
-	D350T1013V1_DSI(d350t1013v1, 0xE7, 0x44, 0x44);
-	D350T1013V1_DSI(d350t1013v1, 0xE8, 0x0D, 0x31, 0xA0, 0xA0, 0x0F, 0x33,
-		0xA0, 0xA0, 0x09, 0x2D, 0xA0, 0xA0, 0x0B, 0x2F, 0xA0, 0xA0);
-	D350T1013V1_DSI(d350t1013v1, 0xEB, 0x00, 0x01, 0xE4, 0xE4, 0x44, 0x88,
-		0x00);
-	D350T1013V1_DSI(d350t1013v1, 0xED, 0xFF, 0xF5, 0x47, 0x6F, 0x0B, 0xA1,
-		0xA2, 0xBF, 0xFB, 0x2A, 0x1A, 0xB0, 0xF6, 0x74, 0x5F, 0xFF);
-	D350T1013V1_DSI(d350t1013v1, 0xEF, 0x08, 0x08, 0x08, 0x40, 0x3F, 0x64);
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x13);
-	D350T1013V1_DSI(d350t1013v1, 0xE8, 0x00, 0x0E);
- 	msleep(200);
-
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x00);
-	D350T1013V1_DSI(d350t1013v1, 0x11);
-	msleep(200);
-
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x13);
-	D350T1013V1_DSI(d350t1013v1, 0xE8, 0x00, 0x0C);
-	msleep(200);
-
-	D350T1013V1_DSI(d350t1013v1, 0xE8, 0x00, 0x00);
-	D350T1013V1_DSI(d350t1013v1, 0xFF, 0x77, 0x01, 0x00, 0x00, 0x00);
-
-	D350T1013V1_DSI(d350t1013v1, 0x3A, 0x50);
-	msleep(200);
+static const struct backlight_ops d350t1013v1_bl_ops = {
+	.update_status = d350t1013v1_bl_update_status,
+};
+
+/*
+ * Registers a backlight device driving the controller's DCS brightness
+ * registers, if requested by "dxwy,dcs-backlight" and no external
+ * backlight is configured.
+ */
+static int d350t1013v1_init_backlight(struct d350t1013v1 *d350t1013v1)
+{
+	struct device *dev = &d350t1013v1->dsi->dev;
+	struct backlight_properties props = {
+		.type = BACKLIGHT_RAW,
+		.brightness = D350T1013V1_MAX_BRIGHTNESS,
+		.max_brightness = D350T1013V1_MAX_BRIGHTNESS,
+	};
+	struct backlight_device *bl;
+
+	if (!device_property_read_bool(dev, "dxwy,dcs-backlight"))
+		return 0;
+
+	if (d350t1013v1->panel.backlight) {
+		dev_warn(dev, "external backlight configured, ignoring DCS backlight\n");
+		return 0;
+	}
+
+	bl = devm_backlight_device_register(dev, dev_name(dev), dev, d350t1013v1,
+					    &d350t1013v1_bl_ops, &props);
+	if (IS_ERR(bl))
+		return PTR_ERR(bl);
+
+	d350t1013v1->dcs_backlight = bl;
+	d350t1013v1->panel.backlight = bl;
+
+	return 0;
 }
 
-static int d350t1013v1_prepare(struct drm_panel *panel)
+static const char * const d350t1013v1_video_mode_names[] = {
+	"burst",
+	"sync-pulse",
+	"sync-event",
+};
+
+static const unsigned long d350t1013v1_video_mode_flags[] = {
+	MIPI_DSI_MODE_VIDEO_BURST,
+	MIPI_DSI_MODE_VIDEO_SYNC_PULSE,
+	0,
+};
+
+/*
+ * Configures the DSI link from the panel description, optionally
+ * overridden by the "dxwy,dsi-lanes", "dxwy,continuous-clock",
+ * "dxwy,video-mode" and "dxwy,hs-rate-hz" properties. Needs the pixel
+ * format to be set up.
+ */
+static int d350t1013v1_init_link(struct mipi_dsi_device *dsi,
+				 const struct d350t1013v1_panel_desc *desc)
 {
-	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	struct device *dev = &dsi->dev;
+	const char *name;
+	u32 value;
 	int ret;
-	u8 ids[3];
 
-	gpiod_set_value(d350t1013v1->reset, 0);
+	dsi->mode_flags = desc->flags;
+	dsi->lanes = desc->lanes;
 
-	ret = regulator_bulk_enable(d350t1013v1->desc->num_supplies,
-				    d350t1013v1->supplies);
-	if (ret < 0)
-		return ret;
-	msleep(250);
+	if (!device_property_read_u32(dev, "dxwy,dsi-lanes", &value)) {
+		if (!value || value > D350T1013V1_MAX_LANES) {
+			dev_err(dev, "invalid number of DSI lanes %u\n", value);
+			return -EINVAL;
+		}
+		dsi->lanes = value;
+	}
 
-	gpiod_set_value(d350t1013v1->reset, 1);
-	msleep(250);
+	if (device_property_read_bool(dev, "dxwy,continuous-clock"))
+		dsi->mode_flags &= ~MIPI_DSI_CLOCK_NON_CONTINUOUS;
+
+	if (!device_property_read_string(dev, "dxwy,video-mode", &name)) {
+		ret = match_string(d350t1013v1_video_mode_names,
+				   ARRAY_SIZE(d350t1013v1_video_mode_names), name);
+		if (ret < 0) {
+			dev_err(dev, "invalid video mode %s\n", name);
+			return ret;
+		}
+		dsi->mode_flags &= ~(MIPI_DSI_MODE_VIDEO_BURST |
+				     MIPI_DSI_MODE_VIDEO_SYNC_PULSE);
+		dsi->mode_flags |= d350t1013v1_video_mode_flags[ret];
+	}
 
-	ret = mipi_dsi_dcs_soft_reset(d350t1013v1->dsi);
-	if (ret < 0)
-		return ret;
-	msleep(100);
+	if (!device_property_read_u32(dev, "dxwy,hs-rate-hz", &value)) {
+		if (!value || value > D350T1013V1_MAX_HS_RATE) {
+			dev_err(dev, "invalid HS rate %u Hz\n", value);
+			return -EINVAL;
+		}
+		dsi->hs_rate = value;
+	}
 
-	ret = mipi_dsi_dcs_exit_sleep_mode(d350t1013v1->dsi);
-	if (ret < 0)
-		return ret;
-	msleep(100);
+	/*
+	 * The preferred mode has to fit into the configured lanes, faster
+	 * modes that don't are left out by get_modes().
+	 */
+	if (!d350t1013v1_mode_fits(dsi, &desc->modes[0])) {
+		dev_err(dev, "%u lanes can't carry the preferred mode\n",
+			dsi->lanes);
+		return -EINVAL;
+	}
 
-	/* Reading the display id ensures that the DSI link is working. */
-	ret = mipi_dsi_dcs_read(d350t1013v1->dsi, MIPI_DCS_GET_DISPLAY_ID,
-							ids, sizeof(ids));
-	if (ret < 0)
-		return ret;
-	dev_info(&d350t1013v1->dsi->dev, "display id: %02x %02x %02x\n",
-			ids[0], ids[1], ids[2]);
+	return 0;
+}
+
+static const char * const d350t1013v1_format_names[] = {
+	[MIPI_DSI_FMT_RGB888]	= "rgb888",
+	[MIPI_DSI_FMT_RGB666]	= "rgb666",
+	[MIPI_DSI_FMT_RGB666_PACKED] = "rgb666-packed",
+	[MIPI_DSI_FMT_RGB565]	= "rgb565",
+};
+
+/*
+ * Selects the pixel format from the optional "dxwy,pixel-format" property
+ * and derives the matching COLMOD value, whose bits 6:4 set the bits per
+ * pixel of the RGB interface inside the controller.
+ */
+static int d350t1013v1_init_format(struct d350t1013v1 *d350t1013v1,
+				   struct mipi_dsi_device *dsi,
+				   const struct d350t1013v1_panel_desc *desc)
+{
+	const char *name;
+	int ret;
+
+	dsi->format = desc->format;
 
-	d350t1013v1_init_sequence(d350t1013v1);
+	if (!device_property_read_string(&dsi->dev, "dxwy,pixel-format", &name)) {
+		ret = match_string(d350t1013v1_format_names,
+				   ARRAY_SIZE(d350t1013v1_format_names), name);
+		if (ret < 0) {
+			dev_err(&dsi->dev, "invalid pixel format %s\n", name);
+			return ret;
+		}
+		dsi->format = ret;
+	}
+
+	switch (dsi->format) {
+	case MIPI_DSI_FMT_RGB888:
+		d350t1013v1->colmod = MIPI_DCS_PIXEL_FMT_24BIT << 4;
+		d350t1013v1->bus_format = MEDIA_BUS_FMT_RGB888_1X24;
+		d350t1013v1->bpc = 8;
+		break;
+	case MIPI_DSI_FMT_RGB666:
+	case MIPI_DSI_FMT_RGB666_PACKED:
+		d350t1013v1->colmod = MIPI_DCS_PIXEL_FMT_18BIT << 4;
+		d350t1013v1->bus_format = MEDIA_BUS_FMT_RGB666_1X18;
+		d350t1013v1->bpc = 6;
+		break;
+	case MIPI_DSI_FMT_RGB565:
+		d350t1013v1->colmod = MIPI_DCS_PIXEL_FMT_16BIT << 4;
+		d350t1013v1->bus_format = MEDIA_BUS_FMT_RGB565_1X16;
+		d350t1013v1->bpc = 6;
+		break;
+	}
 
 	return 0;
 }
 
-static int d350t1013v1_enable(struct drm_panel *panel)
+static bool d350t1013v1_valid_bksel(const struct d350t1013v1_cmd *cmd)
 {
-	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	static const u8 bksel[] = { D350T1013V1_BKSEL, 0x77, 0x01, 0x00, 0x00 };
 
-	return mipi_dsi_dcs_set_display_on(d350t1013v1->dsi);
+	return d350t1013v1_is_bksel(cmd) && !memcmp(cmd->data, bksel, sizeof(bksel));
 }
 
-static int d350t1013v1_disable(struct drm_panel *panel)
+/*
+ * Checks the rules the bring-up relies upon: bank selects are well-formed,
+ * sleep-out is followed by its settle time, reset and display-on are left
+ * to the driver, and the sequence returns to command 1, where the driver
+ * sends the pixel format and later commands.
+ */
+static int d350t1013v1_check_init_cmds(struct device *dev,
+				       const struct d350t1013v1_cmd *cmds,
+				       unsigned int num_cmds)
 {
-	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	u8 bank = D350T1013V1_BANK_NONE;
+	unsigned int i;
+
+	for (i = 0; i < num_cmds; i++) {
+		const struct d350t1013v1_cmd *cmd = &cmds[i];
+
+		if (!cmd->len || cmd->delay >= D350T1013V1_NUM_DELAYS)
+			goto err_invalid;
+
+		switch (cmd->data[0]) {
+		case D350T1013V1_BKSEL:
+			if (!d350t1013v1_valid_bksel(cmd))
+				goto err_invalid;
+			bank = cmd->data[D350T1013V1_BKSEL_LEN - 1];
+			break;
+		case MIPI_DCS_EXIT_SLEEP_MODE:
+			if (bank == D350T1013V1_BANK_NONE &&
+			    cmd->delay != D350T1013V1_DELAY_SLEEP_OUT)
+				goto err_invalid;
+			break;
+		case MIPI_DCS_SOFT_RESET:
+		case MIPI_DCS_SET_DISPLAY_ON:
+			if (bank == D350T1013V1_BANK_NONE)
+				goto err_invalid;
+			break;
+		}
+	}
+
+	if (bank != D350T1013V1_BANK_NONE) {
+		dev_err(dev, "init sequence ends in command 2 bank %02x\n", bank);
+		return -EINVAL;
+	}
 
-	return mipi_dsi_dcs_set_display_off(d350t1013v1->dsi);
+	return 0;
+
+err_invalid:
+	dev_err(dev, "invalid init command %u (%02x)\n", i, cmds[i].data[0]);
+	return -EINVAL;
 }
 
-static int d350t1013v1_unprepare(struct drm_panel *panel)
+/*
+ * Registers a profile may write: the positive and negative gamma B0h/B1h
+ * of bank 0x10 and the power registers B0h-C2h, D0h and EEh of bank 0x11.
+ * The GIP timing registers E0h-EFh, which share bank 0x11, are left to
+ * the init sequence.
+ */
+static bool d350t1013v1_is_profile_reg(u8 bank, u8 opcode)
 {
-	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
+	switch (bank) {
+	case D350T1013V1_BANK_GAMMA:
+		return opcode == 0xB0 || opcode == 0xB1;
+	case D350T1013V1_BANK_POWER:
+		return (opcode >= 0xB0 && opcode <= 0xC2) || opcode == 0xD0 ||
+		       opcode == 0xEE;
+	}
+
+	return false;
+}
+
+/*
+ * Checks that a profile only writes profile registers, so that applying
+ * it at runtime can't disturb the rest of the configuration. Profiles are
+ * sent while the display runs and must not have post-delays.
+ */
+static int d350t1013v1_check_profile_cmds(struct device *dev,
+					  const struct d350t1013v1_cmd *cmds,
+					  unsigned int num_cmds)
+{
+	u8 bank = D350T1013V1_BANK_NONE;
+	unsigned int i;
+	u8 opcode;
+
+	for (i = 0; i < num_cmds; i++) {
+		opcode = cmds[i].data[0];
+
+		if (cmds[i].delay != D350T1013V1_DELAY_NONE) {
+			dev_err(dev, "profile command %u (%02x) has a delay\n",
+				i, opcode);
+			return -EINVAL;
+		}
+
+		if (opcode == D350T1013V1_BKSEL) {
+			bank = cmds[i].data[cmds[i].len - 1];
+			if (d350t1013v1_valid_bksel(&cmds[i]) &&
+			    (bank == D350T1013V1_BANK_GAMMA ||
+			     bank == D350T1013V1_BANK_POWER))
+				continue;
+		} else if (d350t1013v1_is_profile_reg(bank, opcode)) {
+			continue;
+		}
+
+		dev_err(dev, "profile command %u (%02x) not a gamma or power register\n",
+			i, opcode);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Parses a command firmware, an init sequence or a profile, into a command
+ * table checked by check. The firmware is validated before anything is
+ * allocated, all allocations are device managed and live as long as the
+ * driver is bound.
+ */
+static int d350t1013v1_parse_fw(struct device *dev, const struct firmware *fw,
+				int (*check)(struct device *dev,
+					     const struct d350t1013v1_cmd *cmds,
+					     unsigned int num_cmds),
+				struct d350t1013v1_cmd **cmds_out,
+				unsigned int *num_cmds_out)
+{
+	const u8 *pos = fw->data + D350T1013V1_FW_MAGIC_LEN;
+	const u8 *end = fw->data + fw->size;
+	struct d350t1013v1_cmd *cmds;
+	unsigned int num_cmds = 0;
+	size_t data_len = 0;
+	u8 *data;
+	u8 len;
 	int ret;
 
-	ret = mipi_dsi_dcs_enter_sleep_mode(d350t1013v1->dsi);
-	if (ret < 0)
+	if (fw->size < D350T1013V1_FW_MAGIC_LEN ||
+	    memcmp(fw->data, D350T1013V1_FW_MAGIC, D350T1013V1_FW_MAGIC_LEN))
+		return -EINVAL;
+
+	while (pos < end) {
+		/* Opcode, length, payload and delay. */
+		if (end - pos < 3)
+			return -EINVAL;
+		len = pos[1];
+		if (len > D350T1013V1_FW_MAX_PAYLOAD || end - pos < len + 3 ||
+		    pos[len + 2] >= D350T1013V1_NUM_DELAYS)
+			return -EINVAL;
+
+		data_len += len + 1;
+		num_cmds++;
+		pos += len + 3;
+	}
+
+	if (!num_cmds)
+		return -EINVAL;
+
+	cmds = devm_kcalloc(dev, num_cmds, sizeof(*cmds), GFP_KERNEL);
+	data = devm_kmalloc(dev, data_len, GFP_KERNEL);
+	if (!cmds || !data)
+		return -ENOMEM;
+
+	/* The opcode and payload of a command are sent as one buffer. */
+	pos = fw->data + D350T1013V1_FW_MAGIC_LEN;
+	for (num_cmds = 0; pos < end; num_cmds++) {
+		len = pos[1];
+		data[0] = pos[0];
+		memcpy(&data[1], &pos[2], len);
+
+		cmds[num_cmds].data = data;
+		cmds[num_cmds].len = len + 1;
+		cmds[num_cmds].delay = pos[len + 2];
+
+		data += len + 1;
+		pos += len + 3;
+	}
+
+	ret = check(dev, cmds, num_cmds);
+	if (ret) {
+		devm_kfree(dev, cmds[0].data);
+		devm_kfree(dev, cmds);
 		return ret;
-	msleep(150);
+	}
 
-	regulator_bulk_disable(d350t1013v1->desc->num_supplies, d350t1013v1->supplies);
+	*cmds_out = cmds;
+	*num_cmds_out = num_cmds;
 
 	return 0;
 }
 
-static int d350t1013v1_get_modes(struct drm_panel *panel,
-			    struct drm_connector *connector)
+/*
+ * Selects the init sequence. A firmware named by the "firmware-name"
+ * property, or the default name, replaces the built-in table so that
+ * gamma and power settings can be tuned without rebuilding the module.
+ * It is parsed once here, prepare() only executes the resulting table.
+ */
+static int d350t1013v1_load_init_cmds(struct d350t1013v1 *d350t1013v1,
+				       struct device *dev,
+				       const struct d350t1013v1_panel_desc *desc)
 {
-	struct d350t1013v1 *d350t1013v1 = panel_to_d350t1013v1(panel);
-	const struct drm_display_mode *desc_mode = d350t1013v1->desc->mode;
-	struct drm_display_mode *mode;
+	const char *name = desc->firmware_name;
+	const struct firmware *fw;
+	struct d350t1013v1_cmd *cmds;
+	unsigned int num_cmds;
+	int ret;
 
-	mode = drm_mode_duplicate(connector->dev, desc_mode);
-	if (!mode) {
-		dev_err(&d350t1013v1->dsi->dev, "failed to add mode %ux%u@%u\n",
-			desc_mode->hdisplay, desc_mode->vdisplay,
-			drm_mode_vrefresh(desc_mode));
-		return -ENOMEM;
+	/* Catches mistakes in the built-in table before using a panel. */
+	ret = d350t1013v1_check_init_cmds(dev, desc->init_cmds,
+					  desc->num_init_cmds);
+	if (ret)
+		return ret;
+
+	d350t1013v1->init_cmds = desc->init_cmds;
+	d350t1013v1->num_init_cmds = desc->num_init_cmds;
+
+	device_property_read_string(dev, "firmware-name", &name);
+
+	ret = firmware_request_nowarn(&fw, name, dev);
+	if (ret) {
+		dev_dbg(dev, "no init firmware %s (%d), using built-in sequence\n",
+			name, ret);
+		return 0;
 	}
 
-	drm_mode_set_name(mode);
-	drm_mode_probed_add(connector, mode);
+	ret = d350t1013v1_parse_fw(dev, fw, d350t1013v1_check_init_cmds,
+				   &cmds, &num_cmds);
+	if (ret) {
+		dev_warn(dev, "invalid init firmware %s (%d), using built-in sequence\n",
+			 name, ret);
+	} else {
+		dev_info(dev, "using init sequence %s (%u commands)\n",
+			 name, num_cmds);
+		d350t1013v1->init_cmds = cmds;
+		d350t1013v1->num_init_cmds = num_cmds;
+	}
 
-	connector->display_info.width_mm = desc_mode->width_mm;
-	connector->display_info.height_mm = desc_mode->height_mm;
+	release_firmware(fw);
 
-	return 1;
+	return 0;
 }
 
-static const struct drm_panel_funcs d350t1013v1_funcs = {
-	.disable	= d350t1013v1_disable,
-	.unprepare	= d350t1013v1_unprepare,
-	.prepare	= d350t1013v1_prepare,
-	.enable		= d350t1013v1_enable,
-	.get_modes	= d350t1013v1_get_modes,
-};
+/*
+ * Builds the default profile out of the gamma and power writes of the
+ * init sequence, so that switching back to it restores the init values.
+ * The settle time of the power settings is only needed by the bring-up,
+ * a running panel takes the new values within the next frames.
+ */
+static int d350t1013v1_default_profile(struct d350t1013v1 *d350t1013v1,
+				       struct device *dev,
+				       struct d350t1013v1_profile *profile)
+{
+	const struct d350t1013v1_cmd *cmds = d350t1013v1->init_cmds;
+	struct d350t1013v1_cmd *profile_cmds = NULL;
+	unsigned int i, n, pass;
+	u8 bank;
+
+	/* The first pass counts, the second one copies. */
+	for (pass = 0; pass < 2; pass++) {
+		bank = D350T1013V1_BANK_NONE;
+		for (i = 0, n = 0; i < d350t1013v1->num_init_cmds; i++) {
+			if (d350t1013v1_is_bksel(&cmds[i])) {
+				bank = cmds[i].data[D350T1013V1_BKSEL_LEN - 1];
+				if (bank != D350T1013V1_BANK_GAMMA &&
+				    bank != D350T1013V1_BANK_POWER)
+					continue;
+			} else if (!d350t1013v1_is_profile_reg(bank, cmds[i].data[0])) {
+				continue;
+			}
+
+			if (profile_cmds) {
+				profile_cmds[n] = cmds[i];
+				profile_cmds[n].delay = D350T1013V1_DELAY_NONE;
+			}
+			n++;
+		}
+
+		if (!pass) {
+			profile_cmds = devm_kcalloc(dev, n, sizeof(*profile_cmds),
+						    GFP_KERNEL);
+			if (!profile_cmds)
+				return -ENOMEM;
+		}
+	}
 
-static struct drm_display_mode d350t1013v1_mode = {
-	.clock 			= 25000,
+	profile->name = "default";
+	profile->cmds = profile_cmds;
+	profile->num_cmds = n;
 
-	.hdisplay		= 480,
-	.hsync_start	= 480 + 50,
-	.hsync_end		= 480 + 50 + 16,
-	.htotal			= 480 + 50 + 16 + 2,
+	return 0;
+}
 
-	.vdisplay		= 800,
-	.vsync_start	= 800 + 16,
-	.vsync_end		= 800 + 16 + 14,
-	.vtotal			= 800 + 16 + 14 + 2,
+/*
+ * Sets up the default profile and loads the ones named by the
+ * "dxwy,profiles" property from the firmware files
+ * dxwy-d350t1013v1-profile-<name>.bin.
+ */
+static int d350t1013v1_init_profiles(struct d350t1013v1 *d350t1013v1,
+				     struct device *dev)
+{
+	const char *names[D350T1013V1_MAX_PROFILES - 1];
+	struct d350t1013v1_profile *profiles;
+	const struct firmware *fw;
+	struct d350t1013v1_cmd *cmds;
+	unsigned int num_cmds, n;
+	char fw_name[64];
+	int count, ret, i;
+
+	count = device_property_string_array_count(dev, "dxwy,profiles");
+	if (count < 0)
+		count = 0;
+	if (count > ARRAY_SIZE(names)) {
+		dev_warn(dev, "only %zu profiles supported\n", ARRAY_SIZE(names));
+		count = ARRAY_SIZE(names);
+	}
+	if (count)
+		count = device_property_read_string_array(dev, "dxwy,profiles",
+							  names, count);
+	if (count < 0)
+		return count;
+
+	profiles = devm_kcalloc(dev, count + 1, sizeof(*profiles), GFP_KERNEL);
+	if (!profiles)
+		return -ENOMEM;
 
-	.width_mm		= 45,
-	.height_mm		= 76,
+	ret = d350t1013v1_default_profile(d350t1013v1, dev,
+					  &profiles[D350T1013V1_PROFILE_DEFAULT]);
+	if (ret)
+		return ret;
 
-	.type = DRM_MODE_TYPE_DRIVER | DRM_MODE_TYPE_PREFERRED,
-};
+	for (i = 0, n = 1; i < count; i++) {
+		snprintf(fw_name, sizeof(fw_name), "dxwy-d350t1013v1-profile-%s.bin",
+			 names[i]);
+
+		ret = firmware_request_nowarn(&fw, fw_name, dev);
+		if (ret) {
+			dev_warn(dev, "missing profile %s: %d\n", fw_name, ret);
+			continue;
+		}
+
+		ret = d350t1013v1_parse_fw(dev, fw, d350t1013v1_check_profile_cmds,
+					   &cmds, &num_cmds);
+		release_firmware(fw);
+		if (ret) {
+			dev_warn(dev, "invalid profile %s: %d\n", fw_name, ret);
+			continue;
+		}
+
+		profiles[n].name = names[i];
+		profiles[n].cmds = cmds;
+		profiles[n].num_cmds = num_cmds;
+		n++;
+	}
 
-static const char * const d350t1013v1_supply_names[] = {
-	"vcc",
-};
+	d350t1013v1->profiles = profiles;
+	d350t1013v1->num_profiles = n;
 
-static const struct d350t1013v1_panel_desc d350t1013v1_desc = {
-	.mode = &d350t1013v1_mode,
-	.lanes = 2,
-	.flags = MIPI_DSI_MODE_VIDEO |  MIPI_DSI_CLOCK_NON_CONTINUOUS |
-			MIPI_DSI_MODE_LPM,
-	.format = MIPI_DSI_FMT_RGB888,
-	.supply_names = d350t1013v1_supply_names,
-	.num_supplies = ARRAY_SIZE(d350t1013v1_supply_names),
-};
+	return 0;
+}
+
+/*
+ * The defaults are the minimum timings the panel is known to work with,
+ * shorter timings are accepted for qualified units but warned about.
+ */
+static void d350t1013v1_timing_override(struct device *dev, const char *name,
+					unsigned int *value, int param)
+{
+	if (param < 0)
+		return;
+
+	if (param < *value)
+		dev_warn(dev, "%s of %d ms is below the panel minimum of %u ms\n",
+			 name, param, *value);
+	*value = param;
+}
+
+#define D350T1013V1_TIMING_OVERRIDE(_name) \
+	d350t1013v1_timing_override(dev, #_name, &timings->_name, _name)
+
+static void d350t1013v1_init_timings(struct d350t1013v1 *d350t1013v1)
+{
+	struct d350t1013v1_timings *timings = &d350t1013v1->timings;
+	struct device *dev = &d350t1013v1->dsi->dev;
+
+	*timings = *d350t1013v1->desc->timings;
+
+	D350T1013V1_TIMING_OVERRIDE(supply_ramp_ms);
+	D350T1013V1_TIMING_OVERRIDE(reset_ms);
+	D350T1013V1_TIMING_OVERRIDE(soft_reset_ms);
+	D350T1013V1_TIMING_OVERRIDE(sleep_out_ms);
+	D350T1013V1_TIMING_OVERRIDE(power_setup_ms);
+	D350T1013V1_TIMING_OVERRIDE(analog_setup_ms);
+	D350T1013V1_TIMING_OVERRIDE(colmod_ms);
+	D350T1013V1_TIMING_OVERRIDE(sleep_in_ms);
+}
+
+/* Drops an early power-up that was never consumed by prepare(). */
+static void d350t1013v1_remove_early(struct d350t1013v1 *d350t1013v1)
+{
+	if (!d350t1013v1_take_early_pm(d350t1013v1))
+		return;
+
+	mutex_lock(&d350t1013v1->lock);
+	if (d350t1013v1->powered)
+		d350t1013v1_power_off(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
+
+	pm_runtime_put_noidle(&d350t1013v1->dsi->dev);
+}
 
 static int d350t1013v1_dsi_probe(struct mipi_dsi_device *dsi)
 {
@@ -264,9 +2976,18 @@ static int d350t1013v1_dsi_probe(struct mipi_dsi_device *dsi)
 		return -ENOMEM;
 
 	desc = of_device_get_match_data(&dsi->dev);
-	dsi->mode_flags = desc->flags;
-	dsi->format = desc->format;
-	dsi->lanes = desc->lanes;
+
+	mipi_dsi_set_drvdata(dsi, d350t1013v1);
+	d350t1013v1->dsi = dsi;
+	d350t1013v1->desc = desc;
+
+	ret = d350t1013v1_init_format(d350t1013v1, dsi, desc);
+	if (ret)
+		return ret;
+
+	ret = d350t1013v1_init_link(dsi, desc);
+	if (ret)
+		return ret;
 
 	d350t1013v1->supplies = devm_kcalloc(&dsi->dev, desc->num_supplies,
 					sizeof(*d350t1013v1->supplies),
@@ -280,14 +3001,36 @@ static int d350t1013v1_dsi_probe(struct mipi_dsi_device *dsi)
 	ret = devm_regulator_bulk_get(&dsi->dev, desc->num_supplies,
 				      d350t1013v1->supplies);
 	if (ret < 0)
+		return dev_err_probe(&dsi->dev, ret, "Couldn't get our supplies\n");
+
+	/* Keep a panel lit by the bootloader out of reset for the handover. */
+	d350t1013v1->handover = handover;
+	d350t1013v1->reset = devm_gpiod_get(&dsi->dev, "reset",
+					    handover ? GPIOD_OUT_HIGH : GPIOD_OUT_LOW);
+	if (IS_ERR(d350t1013v1->reset))
+		return dev_err_probe(&dsi->dev, PTR_ERR(d350t1013v1->reset),
+				     "Couldn't get our reset GPIO\n");
+
+	d350t1013v1_init_timings(d350t1013v1);
+	INIT_WORK(&d350t1013v1->init_work, d350t1013v1_init_work);
+	INIT_WORK(&d350t1013v1->early_work, d350t1013v1_early_work);
+	INIT_DELAYED_WORK(&d350t1013v1->off_work, d350t1013v1_off_work);
+	INIT_DELAYED_WORK(&d350t1013v1->esd_work, d350t1013v1_esd_work);
+	init_completion(&d350t1013v1->init_done);
+	complete_all(&d350t1013v1->init_done);
+	d350t1013v1->init_ret = -ENODEV;
+	mutex_init(&d350t1013v1->lock);
+	mutex_init(&d350t1013v1->stats_lock);
+	d350t1013v1->partial_end = desc->modes[0].vdisplay / 10 - 1;
+	d350t1013v1->state_since = ktime_get();
+	d350t1013v1->state_entries[D350T1013V1_STATE_OFF] = 1;
+
+	pm_runtime_set_autosuspend_delay(&dsi->dev, autosuspend_delay_ms);
+	pm_runtime_use_autosuspend(&dsi->dev);
+	ret = devm_pm_runtime_enable(&dsi->dev);
+	if (ret)
 		return ret;
 
-	d350t1013v1->reset = devm_gpiod_get(&dsi->dev, "reset", GPIOD_OUT_LOW);
-	if (IS_ERR(d350t1013v1->reset)) {
-		dev_err(&dsi->dev, "Couldn't get our reset GPIO\n");
-		return PTR_ERR(d350t1013v1->reset);
-	}
-
 #ifdef RPI_KERNEL
 	/* Raspberry Pi downstream kernels require this to be set for the
 	   DSI interface to be initialized. */
@@ -298,24 +3041,70 @@ static int d350t1013v1_dsi_probe(struct mipi_dsi_device *dsi)
 		       DRM_MODE_CONNECTOR_DSI);
 
 	ret = drm_panel_of_backlight(&d350t1013v1->panel);
+	if (ret)
+		return dev_err_probe(&dsi->dev, ret, "Couldn't get our backlight\n");
+
+	ret = d350t1013v1_init_backlight(d350t1013v1);
+	if (ret)
+		return dev_err_probe(&dsi->dev, ret,
+				     "Couldn't register DCS backlight\n");
+
+	/* Only look up the firmware once all resources that may defer are in. */
+	ret = d350t1013v1_load_init_cmds(d350t1013v1, &dsi->dev, desc);
 	if (ret)
 		return ret;
 
+	ret = d350t1013v1_init_profiles(d350t1013v1, &dsi->dev);
+	if (ret)
+		return ret;
+
+	d350t1013v1->cmd_failures = devm_kcalloc(&dsi->dev, d350t1013v1->num_init_cmds,
+						 sizeof(*d350t1013v1->cmd_failures),
+						 GFP_KERNEL);
+	if (!d350t1013v1->cmd_failures)
+		return -ENOMEM;
+
+	/* The panel is fully set up before it becomes visible to DRM. */
+	d350t1013v1_debugfs_init(d350t1013v1);
 	drm_panel_add(&d350t1013v1->panel);
 
-	mipi_dsi_set_drvdata(dsi, d350t1013v1);
-	d350t1013v1->dsi = dsi;
-	d350t1013v1->desc = desc;
+	/* A panel handed over by the bootloader must not be reset. */
+	if (early_init && !handover) {
+		ret = pm_runtime_resume_and_get(&dsi->dev);
+		if (ret == 0) {
+			d350t1013v1->early_pm = true;
+			queue_work(system_unbound_wq, &d350t1013v1->early_work);
+		}
+	}
+
+	ret = mipi_dsi_attach(dsi);
+	if (ret) {
+		drm_panel_remove(&d350t1013v1->panel);
+		d350t1013v1_remove_early(d350t1013v1);
+		debugfs_remove_recursive(d350t1013v1->debugfs);
+		return ret;
+	}
 
-	return mipi_dsi_attach(dsi);
+	return 0;
 }
 
 static void d350t1013v1_dsi_remove(struct mipi_dsi_device *dsi)
 {
 	struct d350t1013v1 *d350t1013v1 = mipi_dsi_get_drvdata(dsi);
 
+	/* Waits for a running benchmark, which may re-arm the health check. */
+	debugfs_remove_recursive(d350t1013v1->debugfs);
+
 	mipi_dsi_detach(dsi);
 	drm_panel_remove(&d350t1013v1->panel);
+	flush_work(&d350t1013v1->init_work);
+	cancel_delayed_work_sync(&d350t1013v1->esd_work);
+	cancel_delayed_work_sync(&d350t1013v1->off_work);
+	d350t1013v1_remove_early(d350t1013v1);
+
+	mutex_lock(&d350t1013v1->lock);
+	d350t1013v1_power_off(d350t1013v1);
+	mutex_unlock(&d350t1013v1->lock);
 }
 
 static const struct of_device_id d350t1013v1_of_match[] = {
@@ -330,6 +3119,9 @@ static struct mipi_dsi_driver d350t1013v1_dsi_driver = {
 	.driver = {
 		.name		= "d350t1013v1",
 		.of_match_table	= d350t1013v1_of_match,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
+		.pm		= pm_ptr(&d350t1013v1_pm_ops),
+		.dev_groups	= d350t1013v1_groups,
 	},
 };
 module_mipi_dsi_driver(d350t1013v1_dsi_driver);
@@ -337,3 +3129,7 @@ module_mipi_dsi_driver(d350t1013v1_dsi_driver);
 MODULE_AUTHOR("Sebastian Urban <surban@surban.net>");
 MODULE_DESCRIPTION("DXWY D350T1013V1 LCD Panel Driver");
 MODULE_LICENSE("GPL");
+
+#ifdef D350T1013V1_KUNIT_TEST
+#include "panel-dxwy-d350t1013v1-test.c"
+#endif